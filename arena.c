@@ -0,0 +1,57 @@
+/* Bump allocator over one block of memory, see arena.h */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "arena.h"
+
+/**
+ * Allocates the block of the arena
+ * @param arena : Arena pointer
+ * @param size : size_t Bytes available to arena_alloc
+ * @return 1 on success, 0 when out of memory
+ */
+int arena_init(Arena *arena, size_t size)
+{
+    arena->memory = malloc(size + ARENA_ALIGNMENT);
+    arena->size = 0;
+    arena->used = 0;
+    if (arena->memory == NULL)
+    {
+        arena->base = NULL;
+        return 0;
+    }
+
+    const uintptr_t address = (uintptr_t) arena->memory;
+    arena->base = (unsigned char *) arena->memory
+        + (ARENA_ALIGNMENT - address % ARENA_ALIGNMENT) % ARENA_ALIGNMENT;
+    arena->size = size;
+    return 1;
+}
+
+void arena_free(Arena *arena)
+{
+    free(arena->memory);
+    arena->memory = NULL;
+    arena->base = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
+
+/* Returns size bytes aligned to ARENA_ALIGNMENT, NULL if they don't fit */
+void *arena_alloc(Arena *arena, size_t size)
+{
+    const size_t block = ARENA_BLOCK(size);
+    if (block > arena->size - arena->used)
+        return NULL;
+
+    void *ptr = arena->base + arena->used;
+    arena->used += block;
+    return ptr;
+}
+
+/* Gives back every buffer at once, the block stays allocated */
+void arena_reset(Arena *arena)
+{
+    arena->used = 0;
+}
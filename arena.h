@@ -0,0 +1,33 @@
+/* Bump allocator over one block of memory
+ *
+ * Buffers are carved off the front of the block and are only ever
+ * freed all at once, so a set of buffers with the same lifetime costs a
+ * single allocation.
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>
+
+/* Every buffer starts on its own cache line, which also satisfies
+ * any SIMD load */
+#define ARENA_ALIGNMENT 64
+/* Bytes arena_alloc takes out of the arena for a buffer of size bytes */
+#define ARENA_BLOCK(size) \
+    (((size) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT)
+
+typedef struct Arena
+{
+    void *memory;
+    unsigned char *base;
+    size_t size;
+    size_t used;
+} Arena;
+
+int arena_init(Arena *arena, size_t size);
+void arena_free(Arena *arena);
+void *arena_alloc(Arena *arena, size_t size);
+void arena_reset(Arena *arena);
+
+#endif // ARENA_H_
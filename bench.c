@@ -0,0 +1,226 @@
+/* Headless benchmark of the curve evaluation kernels
+ *
+ * Runs every evaluator over randomized control sets of degree 3..255
+ * and 10..100k uniformly spaced samples, and reports ns/sample,
+ * samples/sec and the largest deviation from a double precision
+ * de Casteljau reference.
+ *
+ * Usage: bezier_bench [filter]
+ * Only evaluators whose name contains filter are run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "bezier.h"
+
+#define BENCH_SEED 69
+#define BENCH_MAX_POINTS 256
+#define BENCH_MAX_SAMPLES 100000
+/* Every configuration is repeated until it ran for at least this long */
+#define BENCH_MIN_SEC 0.02
+/* Only this many samples, spread evenly over the whole param range from
+ * the first to the last one, are checked against the reference */
+#define BENCH_ERROR_SAMPLES 1000
+
+#define BENCH_WIDTH 640.0f
+#define BENCH_HEIGHT 480.0f
+
+typedef struct Evaluator
+{
+    const char *name;
+    size_t max_points;
+    void (*run)(BatchPath path, Vec2 *ps, size_t n,
+            const float *params, size_t count, Vec2 *out);
+    BatchPath path;
+} Evaluator;
+
+Vec2 xs[BENCH_MAX_POINTS];
+Vec2Fixed xs_fixed[BENCH_MAX_POINTS];
+float px[BENCH_MAX_POINTS], py[BENCH_MAX_POINTS];
+float scratch[BATCH_SCRATCH_FLOATS(BENCH_MAX_POINTS)];
+Bernstein bernstein;
+
+void run_de_casteljau(BatchPath path, Vec2 *ps, size_t n,
+        const float *params, size_t count, Vec2 *out)
+{
+    (void) path;
+    for (size_t i = 0; i < count; i++)
+        out[i] = beziern_sample(ps, xs, n, params[i]);
+}
+
+/* The params are i / (count - 1), the grid forward differencing walks */
+void run_forward(BatchPath path, Vec2 *ps, size_t n,
+        const float *params, size_t count, Vec2 *out)
+{
+    (void) path;
+    (void) params;
+    bezier_forward(ps, n, count - 1, 0, count, out);
+}
+
+void run_de_casteljau_fixed(BatchPath path, Vec2 *ps, size_t n,
+        const float *params, size_t count, Vec2 *out)
+{
+    (void) path;
+    for (size_t i = 0; i < count; i++)
+        out[i] = beziern_sample_fixed(ps, xs_fixed, n, params[i]);
+}
+
+void run_forward_fixed(BatchPath path, Vec2 *ps, size_t n,
+        const float *params, size_t count, Vec2 *out)
+{
+    (void) path;
+    (void) params;
+    bezier_forward_fixed(ps, n, count - 1, 0, count, out);
+}
+
+void run_bernstein(BatchPath path, Vec2 *ps, size_t n,
+        const float *params, size_t count, Vec2 *out)
+{
+    (void) path;
+    bernstein_prepare(&bernstein, ps, n);
+    for (size_t i = 0; i < count; i++)
+        out[i] = bernstein_sample(&bernstein, params[i]);
+}
+
+void run_de_casteljau_batch(BatchPath path, Vec2 *ps, size_t n,
+        const float *params, size_t count, Vec2 *out)
+{
+    bezier_soa(ps, n, px, py);
+    beziern_sample_batch(path, px, py, n, params, count, out, scratch);
+}
+
+void run_bernstein_batch(BatchPath path, Vec2 *ps, size_t n,
+        const float *params, size_t count, Vec2 *out)
+{
+    bernstein_prepare(&bernstein, ps, n);
+    bernstein_sample_batch(path, &bernstein, params, count, out);
+}
+
+const Evaluator evaluators[] = {
+    {"de Casteljau", BENCH_MAX_POINTS, run_de_casteljau, BATCH_SCALAR},
+    {"de Casteljau/scalar", BENCH_MAX_POINTS, run_de_casteljau_batch, BATCH_SCALAR},
+    {"de Casteljau/neon", BENCH_MAX_POINTS, run_de_casteljau_batch, BATCH_NEON},
+    {"de Casteljau/sse", BENCH_MAX_POINTS, run_de_casteljau_batch, BATCH_SSE},
+    {"de Casteljau/avx2", BENCH_MAX_POINTS, run_de_casteljau_batch, BATCH_AVX2},
+    {"de Casteljau/avx512", BENCH_MAX_POINTS, run_de_casteljau_batch, BATCH_AVX512},
+    {"forward", 4, run_forward, BATCH_SCALAR},
+    {"de Casteljau/fixed", BENCH_MAX_POINTS, run_de_casteljau_fixed, BATCH_SCALAR},
+    {"forward/fixed", 4, run_forward_fixed, BATCH_SCALAR},
+    {"Bernstein/Horner", BERNSTEIN_MAX_POINTS, run_bernstein, BATCH_SCALAR},
+    {"Bernstein/scalar", BERNSTEIN_MAX_POINTS, run_bernstein_batch, BATCH_SCALAR},
+    {"Bernstein/neon", BERNSTEIN_MAX_POINTS, run_bernstein_batch, BATCH_NEON},
+    {"Bernstein/sse", BERNSTEIN_MAX_POINTS, run_bernstein_batch, BATCH_SSE},
+    {"Bernstein/avx2", BERNSTEIN_MAX_POINTS, run_bernstein_batch, BATCH_AVX2},
+    {"Bernstein/avx512", BERNSTEIN_MAX_POINTS, run_bernstein_batch, BATCH_AVX512},
+};
+
+const size_t degrees[] = {3, 7, 15, 31, 63, 127, 255};
+const size_t sample_counts[] = {10, 100, 1000, 10000, 100000};
+
+#define ARRAY_LEN(xs) (sizeof(xs) / sizeof((xs)[0]))
+
+double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+float randf(float max)
+{
+    return (float) rand() / (float) RAND_MAX * max;
+}
+
+/* Extended precision de Casteljau the evaluators are compared against */
+void reference_sample(const Vec2 *ps, size_t n, float p, double *x, double *y)
+{
+    static double rx[BENCH_MAX_POINTS], ry[BENCH_MAX_POINTS];
+    for (size_t i = 0; i < n; i++)
+    {
+        rx[i] = ps[i].x;
+        ry[i] = ps[i].y;
+    }
+    for (; n > 1; n--)
+    {
+        for (size_t i = 0; i < n - 1; i++)
+        {
+            rx[i] += (rx[i+1] - rx[i]) * p;
+            ry[i] += (ry[i+1] - ry[i]) * p;
+        }
+    }
+    *x = rx[0];
+    *y = ry[0];
+}
+
+Vec2 ps[BENCH_MAX_POINTS];
+float params[BENCH_MAX_SAMPLES];
+Vec2 out[BENCH_MAX_SAMPLES];
+double ref_x[BENCH_ERROR_SAMPLES], ref_y[BENCH_ERROR_SAMPLES];
+size_t checked_samples[BENCH_ERROR_SAMPLES];
+
+int main(int argc, char *argv[])
+{
+    const char *filter = argc > 1 ? argv[1] : "";
+    srand(BENCH_SEED);
+
+    printf("%-20s %6s %8s %12s %14s %10s\n",
+            "evaluator", "degree", "samples", "ns/sample", "samples/sec", "max error");
+
+    for (size_t d = 0; d < ARRAY_LEN(degrees); d++)
+    {
+        const size_t n = degrees[d] + 1;
+        for (size_t i = 0; i < n; i++)
+            ps[i] = vec2(randf(BENCH_WIDTH), randf(BENCH_HEIGHT));
+
+        for (size_t c = 0; c < ARRAY_LEN(sample_counts); c++)
+        {
+            const size_t count = sample_counts[c];
+            for (size_t i = 0; i < count; i++)
+                params[i] = (float) i / (float) (count - 1);
+
+            const size_t checked = count < BENCH_ERROR_SAMPLES ? count : BENCH_ERROR_SAMPLES;
+            for (size_t i = 0; i < checked; i++)
+            {
+                checked_samples[i] = checked > 1 ? i * (count - 1) / (checked - 1) : 0;
+                reference_sample(ps, n, params[checked_samples[i]], &ref_x[i], &ref_y[i]);
+            }
+
+            for (size_t e = 0; e < ARRAY_LEN(evaluators); e++)
+            {
+                const Evaluator *evaluator = &evaluators[e];
+                if (n > evaluator->max_points
+                    || !batch_path_supported(evaluator->path)
+                    || strstr(evaluator->name, filter) == NULL)
+                    continue;
+
+                size_t reps = 0;
+                const double begin = now_sec();
+                double elapsed;
+                do {
+                    evaluator->run(evaluator->path, ps, n, params, count, out);
+                    reps++;
+                    elapsed = now_sec() - begin;
+                } while (elapsed < BENCH_MIN_SEC);
+
+                double error = 0.0;
+                for (size_t i = 0; i < checked; i++)
+                {
+                    const Vec2 sample = out[checked_samples[i]];
+                    error = fmax(error, fabs(sample.x - ref_x[i]));
+                    error = fmax(error, fabs(sample.y - ref_y[i]));
+                }
+
+                const double samples = (double) reps * (double) count;
+                printf("%-20s %6zu %8zu %12.2f %14.0f %10.2e\n",
+                        evaluator->name, n - 1, count,
+                        elapsed * 1e9 / samples, samples / elapsed, error);
+            }
+        }
+    }
+
+    return 0;
+}
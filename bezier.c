@@ -0,0 +1,460 @@
+/* Bezier curve evaluation kernels, see bezier.h */
+
+#include <math.h>
+
+#include "bezier.h"
+
+
+float lerpf(float a, float b, float t)
+{
+    return a + (b - a) * t;
+}
+
+Vec2 vec2(float x, float y)
+{
+    return (Vec2) {x, y};
+}
+
+Vec2 vec2_add(Vec2 a, Vec2 b)
+{
+    return vec2(a.x + b.x, a.y + b.y);
+}
+
+Vec2 vec2_sub(Vec2 a, Vec2 b)
+{
+    return vec2(a.x - b.x, a.y - b.y);
+}
+
+Vec2 vec2_scale(Vec2 a, float s)
+{
+    return vec2(a.x * s, a.y * s);
+}
+
+Vec2 lerpv2(Vec2 a, Vec2 b, float t)
+{
+    return vec2_add(a, vec2_scale(vec2_sub(b, a), t));
+}
+
+
+/**
+ * de Casteljau for a fixed number of points N: the loops have constant
+ * bounds and are unrolled completely, the levels live in local arrays
+ * the compiler keeps in registers, no scratch and no copy.
+ */
+#define BEZIER_UNROLLED_KERNEL(N)                                   \
+    static Vec2 beziern_sample_##N(const Vec2 *ps, float p)         \
+    {                                                               \
+        float x[N];                                                 \
+        float y[N];                                                 \
+        _Pragma("GCC unroll 16")                                    \
+        for (size_t i = 0; i < N; i++)                              \
+        {                                                           \
+            x[i] = ps[i].x;                                         \
+            y[i] = ps[i].y;                                         \
+        }                                                           \
+        _Pragma("GCC unroll 16")                                    \
+        for (size_t m = N - 1; m > 0; m--)                          \
+        {                                                           \
+            _Pragma("GCC unroll 16")                                \
+            for (size_t i = 0; i < m; i++)                          \
+            {                                                       \
+                x[i] = lerpf(x[i], x[i+1], p);                      \
+                y[i] = lerpf(y[i], y[i+1], p);                      \
+            }                                                       \
+        }                                                           \
+        return vec2(x[0], y[0]);                                    \
+    }
+
+static Vec2 beziern_sample_1(const Vec2 *ps, float p)
+{
+    (void) p;
+    return ps[0];
+}
+
+BEZIER_UNROLLED_KERNEL(2)
+BEZIER_UNROLLED_KERNEL(3)
+BEZIER_UNROLLED_KERNEL(4)
+BEZIER_UNROLLED_KERNEL(5)
+BEZIER_UNROLLED_KERNEL(6)
+BEZIER_UNROLLED_KERNEL(7)
+BEZIER_UNROLLED_KERNEL(8)
+BEZIER_UNROLLED_KERNEL(9)
+
+/* Indexed by the number of points minus one, degree 0 to
+ * BEZIER_UNROLLED_MAX_POINTS - 1 */
+static Vec2 (*const unrolled_kernels[BEZIER_UNROLLED_MAX_POINTS])(const Vec2 *, float) = {
+    beziern_sample_1,
+    beziern_sample_2,
+    beziern_sample_3,
+    beziern_sample_4,
+    beziern_sample_5,
+    beziern_sample_6,
+    beziern_sample_7,
+    beziern_sample_8,
+    beziern_sample_9,
+};
+
+/**
+ * Bezier Sample that works with arbitrary number of points
+ * Points: a,b,c,d
+ * we will be collapsing things together
+ * So interpolate b/w a & b and store in a
+ *
+ * @Update: ps is never written to, the first level reads it directly
+ * into xs and the others work in place there. Nothing is shared between
+ * calls, so threads only need scratch of their own.
+ *
+ * @param ps : Vec2 Original points
+ * @param xs : Vec2 Intermediate buffer for n - 1 interpolated points
+ * @param n : size_t Number of points
+ * @param p : float Interpolation value
+ * @return the point at p, the origin if there are no points
+ */
+
+Vec2 beziern_sample(const Vec2 *ps, Vec2 *xs, size_t n, float p)
+{
+   if (n == 0)
+       return vec2(0.0f, 0.0f);
+   if (n <= BEZIER_UNROLLED_MAX_POINTS)
+       return unrolled_kernels[n - 1](ps, p);
+
+   for (size_t i = 0; i < n - 1; i++)
+   {
+        xs[i] = lerpv2(ps[i], ps[i+1], p);
+   }
+   n--;
+
+   while (n > 1)
+   {
+        for (size_t i = 0; i < n - 1; i++)
+        {
+            xs[i] = lerpv2(xs[i], xs[i+1], p);
+        }
+        n--;
+   }
+   return xs[0];
+
+}
+
+
+/**
+ * Returns a point after interpolation on given points a,b,c,d
+ */
+Vec2 bezier4_sample(Vec2 a, Vec2 b, Vec2 c, Vec2 d, float p)
+{
+    // Phase 1
+    const Vec2 ab = lerpv2(a, b, p);
+    const Vec2 bc = lerpv2(b, c, p);
+    const Vec2 cd = lerpv2(c, d, p);
+
+    // Phase 2
+    const Vec2 abc = lerpv2(ab, bc, p);
+    const Vec2 bcd = lerpv2(bc, cd, p);
+
+    // Phase 3
+    const Vec2 abcd = lerpv2(abc, bcd, p);
+    return abcd;
+}
+
+/**
+ * Intermediate points of de Casteljau at p, for drawing its construction.
+ * The levels below ps are written one after another: n - 1 points on
+ * the lines between the control points, then n - 2 between those and
+ * so on down to the point on the curve at levels[n * (n - 1) / 2 - 1].
+ * @param ps : Vec2 Control points
+ * @param n : size_t Number of points, at least 2
+ * @param levels : Vec2 Room for n * (n - 1) / 2 points
+ */
+void bezier_construction(const Vec2 *ps, size_t n, float p, Vec2 *levels)
+{
+    const Vec2 *above = ps;
+    for (; n > 1; n--)
+    {
+        for (size_t i = 0; i < n - 1; i++)
+            levels[i] = lerpv2(above[i], above[i+1], p);
+        above = levels;
+        levels += n - 1;
+    }
+}
+
+/**
+ * Number of segments when ps is read as a chain of cubics
+ * ps[0..3], ps[3..6], ... The last segment takes whatever is left,
+ * so it can be a line or a quadratic.
+ * @param n : size_t Number of points
+ */
+size_t bezier_chain_segments(size_t n)
+{
+    return n <= 1 ? 1 : (n - 1 + 2) / 3;
+}
+
+/**
+ * Segment the chain parameter u falls into, u in [0, segments].
+ * Values outside are attached to the first or last segment.
+ */
+size_t bezier_chain_segment(size_t n, float u)
+{
+    const size_t segments = bezier_chain_segments(n);
+    if (u <= 0.0f)
+        return 0;
+
+    const size_t segment = (size_t) u;
+    return segment < segments ? segment : segments - 1;
+}
+
+/**
+ * Samples a chain of cubics, every sample only touches the (up to)
+ * 4 points of its own segment
+ * @param ps : Vec2 Control points
+ * @param n : size_t Number of points
+ * @param u : float Chain parameter, segment i covers [i, i+1]
+ */
+Vec2 bezier_chain_sample(const Vec2 *ps, size_t n, float u)
+{
+    if (n == 1)
+        return ps[0];
+
+    const size_t segment = bezier_chain_segment(n, u);
+    const Vec2 *seg = ps + segment * 3;
+    const size_t left = n - segment * 3;
+    const float p = u - (float) segment;
+
+    switch (left)
+    {
+        case 2:
+            return lerpv2(seg[0], seg[1], p);
+        case 3:
+            return lerpv2(lerpv2(seg[0], seg[1], p), lerpv2(seg[1], seg[2], p), p);
+        default:
+            return bezier4_sample(seg[0], seg[1], seg[2], seg[3], p);
+    }
+}
+
+/**
+ * Power basis a t^3 + b t^2 + c t + d of a line, quadratic or cubic
+ * @param m : size_t Number of points, 1 to 4
+ */
+static void bezier_power_basis(const Vec2 *seg, size_t m, Vec2 *basis)
+{
+    const Vec2 zero = vec2(0.0f, 0.0f);
+    basis[0] = zero;
+    basis[1] = zero;
+    basis[2] = zero;
+    basis[3] = seg[0];
+    switch (m)
+    {
+        case 2:
+            basis[2] = vec2_sub(seg[1], seg[0]);
+            break;
+        case 3:
+            basis[1] = vec2_add(vec2_sub(seg[0], vec2_scale(seg[1], 2.0f)), seg[2]);
+            basis[2] = vec2_scale(vec2_sub(seg[1], seg[0]), 2.0f);
+            break;
+        case 4:
+            basis[0] = vec2_add(vec2_scale(vec2_sub(seg[1], seg[2]), 3.0f),
+                    vec2_sub(seg[3], seg[0]));
+            basis[1] = vec2_scale(vec2_add(vec2_sub(seg[0], vec2_scale(seg[1], 2.0f)), seg[2]), 3.0f);
+            basis[2] = vec2_scale(vec2_sub(seg[1], seg[0]), 3.0f);
+            break;
+    }
+}
+
+/**
+ * Forward differencing of a line, quadratic or cubic at the params
+ * i / steps: three adds per sample. The differences drift with every
+ * add, so they are computed again from the power basis at every
+ * multiple of BEZIER_FORWARD_ANCHOR, which also keeps the samples the
+ * same however the range is split. i == steps is the last point exactly.
+ * @param seg : Vec2 Control points of the segment
+ * @param m : size_t Number of points, at most 4
+ * @param steps : size_t Samples per unit of param
+ * @param first : size_t Index of the first param written to out
+ * @param count : size_t Number of samples written to out
+ */
+void bezier_forward(const Vec2 *seg, size_t m, size_t steps,
+        size_t first, size_t count, Vec2 *out)
+{
+    Vec2 basis[4];
+    bezier_power_basis(seg, m, basis);
+    const Vec2 a = basis[0];
+    const Vec2 b = basis[1];
+    const Vec2 c = basis[2];
+
+    /* With h = 1 / steps the differences at t are
+     * d1 = a (3 t^2 h + 3 t h^2 + h^3) + b (2 t h + h^2) + c h
+     * d2 = a (6 t h^2 + 6 h^3) + 2 b h^2
+     * d3 = 6 a h^3 */
+    const float h = 1.0f / (float) steps;
+    const Vec2 d3 = vec2_scale(a, 6.0f * h * h * h);
+    Vec2 p = basis[3];
+    Vec2 d1 = p;
+    Vec2 d2 = p;
+
+    /* Starts at the anchor before first, skipping what's before it */
+    for (size_t j = first - first % BEZIER_FORWARD_ANCHOR; j < first + count; j++)
+    {
+        if (j == steps)
+        {
+            out[j - first] = seg[m-1];
+            continue;
+        }
+
+        if (j % BEZIER_FORWARD_ANCHOR == 0)
+        {
+            const float t = (float) j / (float) steps;
+            p = vec2_add(vec2_scale(vec2_add(vec2_scale(vec2_add(vec2_scale(a, t), b), t), c), t),
+                    basis[3]);
+            d1 = vec2_add(vec2_add(vec2_scale(a, 3.0f * t * t * h + 3.0f * t * h * h + h * h * h),
+                        vec2_scale(b, 2.0f * t * h + h * h)), vec2_scale(c, h));
+            d2 = vec2_add(vec2_scale(a, 6.0f * t * h * h + 6.0f * h * h * h),
+                    vec2_scale(b, 2.0f * h * h));
+        }
+
+        if (j >= first)
+            out[j - first] = p;
+        p = vec2_add(p, d1);
+        d1 = vec2_add(d1, d2);
+        d2 = vec2_add(d2, d3);
+    }
+}
+
+/**
+ * Precomputes the binomial weighted coefficients of the curve,
+ * needs to be called again whenever ps changes
+ * @param b : Bernstein pointer
+ * @param ps : Vec2 Control points
+ * @param n : size_t Number of points
+ */
+void bernstein_prepare(Bernstein *b, Vec2 *ps, size_t n)
+{
+    double binomial = 1.0;
+    for (size_t i = 0; i < n; i++)
+    {
+        b->xs[i] = binomial * ps[i].x;
+        b->ys[i] = binomial * ps[i].y;
+        binomial = binomial * (double) (n - 1 - i) / (double) (i + 1);
+    }
+    b->n = n;
+}
+
+/**
+ * Evaluates the curve in O(n) with Horner's scheme on the Bernstein form
+ *
+ *   B(p) = (1-p)^d * sum(c_i * (p / (1-p))^i)
+ *
+ * For p >= 0.5 the roles of p and 1-p are swapped so the ratio we
+ * raise to the i-th power never exceeds 1.
+ *
+ * @param b : Bernstein coefficients from bernstein_prepare
+ * @param p : float Interpolation value
+ */
+Vec2 bernstein_sample(const Bernstein *b, float p)
+{
+    const size_t d = b->n - 1;
+    const double t = p;
+    double x, y;
+
+    if (t < 0.5)
+    {
+        const double r = t / (1.0 - t);
+        x = b->xs[d];
+        y = b->ys[d];
+        for (size_t i = d; i-- > 0;)
+        {
+            x = x * r + b->xs[i];
+            y = y * r + b->ys[i];
+        }
+        const double scale = pow(1.0 - t, (double) d);
+        return vec2((float) (x * scale), (float) (y * scale));
+    }
+
+    const double r = (1.0 - t) / t;
+    x = b->xs[0];
+    y = b->ys[0];
+    for (size_t i = 1; i <= d; i++)
+    {
+        x = x * r + b->xs[i];
+        y = y * r + b->ys[i];
+    }
+    const double scale = pow(t, (double) d);
+    return vec2((float) (x * scale), (float) (y * scale));
+}
+
+/**
+ * Basis weight C(d, k) * p^k * (1-p)^(d-k) of control point k for every
+ * parameter, i.e. how far each sample moves per unit the point moves.
+ * The binomial overflows a double past about 1030 points and the powers
+ * underflow, so the whole product is taken in the log domain, which
+ * keeps the weights finite for any number of points. p is clamped to
+ * [0, 1], where the ends are exact.
+ * @param n : size_t Number of points
+ * @param k : size_t Index of the control point
+ * @param params : float Interpolation values
+ * @param count : size_t Number of params
+ * @param weights : float count results
+ */
+void bernstein_weights(size_t n, size_t k,
+        const float *params, size_t count, float *weights)
+{
+    const double d = (double) (n - 1);
+    const double i = (double) k;
+    const double log_binomial = lgamma(d + 1.0) - lgamma(i + 1.0) - lgamma(d - i + 1.0);
+
+    for (size_t j = 0; j < count; j++)
+    {
+        const double t = params[j];
+        if (t <= 0.0)
+            weights[j] = k == 0 ? 1.0f : 0.0f;
+        else if (t >= 1.0)
+            weights[j] = k == n - 1 ? 1.0f : 0.0f;
+        else
+            weights[j] = (float) exp(log_binomial + i * log(t) + (d - i) * log1p(-t));
+    }
+}
+
+/**
+ * Splits the curve at p = 0.5 with de Casteljau.
+ * The left half is written to left, the right half replaces ps:
+ * collapsing ps in place leaves exactly the right half behind.
+ * @param ps : Vec2 Control points, becomes the right half
+ * @param left : Vec2 n points for the left half
+ * @param n : size_t Number of points
+ */
+void bezier_subdivide(Vec2 *ps, Vec2 *left, size_t n)
+{
+    for (size_t k = 0; k < n; k++)
+    {
+        left[k] = ps[0];
+        for (size_t i = 0; i + 1 < n - k; i++)
+        {
+            ps[i] = lerpv2(ps[i], ps[i+1], 0.5f);
+        }
+    }
+}
+
+/**
+ * Checks whether every control point lies within tolerance of the chord
+ * from the first to the last point. The curve stays inside the convex
+ * hull of its control points, so then the chord is a good enough
+ * approximation of the whole curve.
+ */
+int bezier_is_flat(const Vec2 *ps, size_t n, float tolerance)
+{
+    const Vec2 chord = vec2_sub(ps[n-1], ps[0]);
+    const float chord_len2 = chord.x * chord.x + chord.y * chord.y;
+
+    for (size_t i = 1; i + 1 < n; i++)
+    {
+        Vec2 d = vec2_sub(ps[i], ps[0]);
+        if (chord_len2 > 0.0f)
+        {
+            const float t = fmaxf(0.0f, fminf(1.0f,
+                        (d.x * chord.x + d.y * chord.y) / chord_len2));
+            d = vec2_sub(d, vec2_scale(chord, t));
+        }
+
+        if (d.x * d.x + d.y * d.y > tolerance * tolerance)
+            return 0;
+    }
+    return 1;
+}
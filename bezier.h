@@ -0,0 +1,137 @@
+/* Bezier curve evaluation kernels
+ *
+ * Everything in here is plain C without SDL, so it can be shared by the
+ * interactive program and the headless benchmark.
+ */
+
+#ifndef BEZIER_H_
+#define BEZIER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct Vec2
+{
+    float x;
+    float y;
+} Vec2;
+
+float lerpf(float a, float b, float t);
+
+Vec2 vec2(float x, float y);
+Vec2 vec2_add(Vec2 a, Vec2 b);
+Vec2 vec2_sub(Vec2 a, Vec2 b);
+Vec2 vec2_scale(Vec2 a, float s);
+Vec2 lerpv2(Vec2 a, Vec2 b, float t);
+
+/* de Casteljau, O(n^2) per sample, reentrant with xs room for n - 1
+ * points. Up to this many points (degree 8) it runs a kernel unrolled
+ * for the number of points and xs may be NULL */
+#define BEZIER_UNROLLED_MAX_POINTS 9
+Vec2 beziern_sample(const Vec2 *ps, Vec2 *xs, size_t n, float p);
+Vec2 bezier4_sample(Vec2 a, Vec2 b, Vec2 c, Vec2 d, float p);
+
+/* Every intermediate point of de Casteljau, n * (n - 1) / 2 of them */
+void bezier_construction(const Vec2 *ps, size_t n, float p, Vec2 *levels);
+
+/* Chain of cubic segments sharing their end points, O(1) per sample */
+size_t bezier_chain_segments(size_t n);
+size_t bezier_chain_segment(size_t n, float u);
+Vec2 bezier_chain_sample(const Vec2 *ps, size_t n, float u);
+
+/* Forward differencing of up to 4 points at i / steps, O(1) per sample
+ * with the differences recomputed every BEZIER_FORWARD_ANCHOR samples */
+#define BEZIER_FORWARD_ANCHOR 32
+void bezier_forward(const Vec2 *seg, size_t m, size_t steps,
+        size_t first, size_t count, Vec2 *out);
+
+/* Fixed point evaluation, bezier_fixed.c
+ *
+ * 16.16 coordinates, bit exact across machines. Points are clamped to
+ * +-32767, params to [0, 1].
+ */
+
+#define BEZIER_FIXED_SHIFT 16
+#define BEZIER_FIXED_ONE (1 << BEZIER_FIXED_SHIFT)
+/* Forward differencing stays within 1/1000 of a unit up to here */
+#define BEZIER_FORWARD_MAX_STEPS 1024
+
+typedef struct Vec2Fixed
+{
+    int32_t x;
+    int32_t y;
+} Vec2Fixed;
+
+int32_t bezier_to_fixed(float v);
+float bezier_from_fixed(int32_t v);
+
+/* de Casteljau, O(n^2) per sample */
+Vec2 beziern_sample_fixed(const Vec2 *ps, Vec2Fixed *xs, size_t n, float p);
+Vec2 bezier_chain_sample_fixed(const Vec2 *ps, size_t n, float u);
+
+/* Forward differencing of up to 4 points at i / steps, O(1) per sample */
+void bezier_forward_fixed(const Vec2 *seg, size_t m, size_t steps,
+        size_t first, size_t count, Vec2 *out);
+
+/* Bernstein works in double up to about 1020 points. Past that,
+ * (1-p)^d around p = 0.5 drops below DBL_MIN and loses bits, and at
+ * 1031 points C(d, d/2) overflows. The cap is half that, which also
+ * keeps the Bernstein every curve embeds at 8 KiB. Longer curves use
+ * de Casteljau.
+ */
+#define BERNSTEIN_MAX_POINTS 512
+
+/**
+ * Control points premultiplied by their binomial weights C(n-1, i),
+ * kept in double so the weights of high degree curves stay exact enough
+ */
+typedef struct Bernstein
+{
+    double xs[BERNSTEIN_MAX_POINTS];
+    double ys[BERNSTEIN_MAX_POINTS];
+    size_t n;
+} Bernstein;
+
+
+/* Bernstein/Horner, O(n) per sample after an O(n) prepare */
+void bernstein_prepare(Bernstein *b, Vec2 *ps, size_t n);
+Vec2 bernstein_sample(const Bernstein *b, float p);
+void bernstein_weights(size_t n, size_t k,
+        const float *params, size_t count, float *weights);
+
+/* Batched evaluation of many parameters at once, bezier_simd.c */
+
+typedef enum BatchPath
+{
+    BATCH_SCALAR,
+    BATCH_NEON,
+    BATCH_SSE,
+    BATCH_AVX2,
+    BATCH_AVX512,
+    BATCH_PATHS_COUNT,
+} BatchPath;
+
+#define BATCH_MAX_LANES 16
+/* Scratch beziern_sample_batch needs for n points */
+#define BATCH_SCRATCH_FLOATS(n) (2 * (n) * BATCH_MAX_LANES)
+
+extern const char *batch_path_names[BATCH_PATHS_COUNT];
+
+int batch_path_supported(BatchPath path);
+BatchPath batch_path_best(void);
+size_t batch_path_lanes(BatchPath path);
+
+/* Control points in structure of arrays layout for beziern_sample_batch */
+void bezier_soa(const Vec2 *ps, size_t n, float *px, float *py);
+
+void beziern_sample_batch(BatchPath path,
+        const float *px, const float *py, size_t n,
+        const float *params, size_t count, Vec2 *out, float *scratch);
+void bernstein_sample_batch(BatchPath path, const Bernstein *b,
+        const float *params, size_t count, Vec2 *out);
+
+/* Adaptive subdivision helpers */
+void bezier_subdivide(Vec2 *ps, Vec2 *left, size_t n);
+int bezier_is_flat(const Vec2 *ps, size_t n, float tolerance);
+
+#endif // BEZIER_H_
@@ -0,0 +1,190 @@
+/* Batched evaluation kernels
+ *
+ * Not a regular header: bezier_simd.c includes it once per instruction
+ * set, each time with different definitions of
+ *
+ *   BATCH_LANES       number of parameters evaluated at once
+ *   BATCH_NAME(name)  name mangled with the instruction set
+ *   BATCH_TARGET      function attribute enabling the instruction set
+ *
+ * The kernels are written with GCC vector extensions, so the same code
+ * compiles to SSE, AVX2, AVX-512 or NEON depending on BATCH_TARGET.
+ * Every lane holds a different parameter p, control points are
+ * broadcast to all lanes.
+ */
+
+typedef float BATCH_NAME(vf) __attribute__((vector_size(BATCH_LANES * sizeof(float))));
+/* Doubles come in two halves so each half fills exactly one register */
+typedef float BATCH_NAME(vf_half) __attribute__((vector_size(BATCH_LANES / 2 * sizeof(float))));
+typedef double BATCH_NAME(vd) __attribute__((vector_size(BATCH_LANES / 2 * sizeof(double))));
+typedef long long BATCH_NAME(vm) __attribute__((vector_size(BATCH_LANES / 2 * sizeof(double))));
+
+/**
+ * de Casteljau on BATCH_LANES parameters at once.
+ * The first level is interpolated straight from the control points,
+ * the remaining levels collapse in scratch, one vector per point.
+ * @param px, py : float Control points in structure of arrays layout
+ * @param n : size_t Number of points
+ * @param params : float BATCH_LANES interpolation values
+ * @param out : Vec2 BATCH_LANES results
+ * @param scratch : float At least BATCH_SCRATCH_FLOATS(n) floats
+ */
+BATCH_TARGET
+static void BATCH_NAME(decasteljau)(const float *px, const float *py, size_t n,
+        const float *params, Vec2 *out, float *scratch)
+{
+    typedef BATCH_NAME(vf) vf;
+
+    if (n == 1)
+    {
+        for (size_t l = 0; l < BATCH_LANES; l++)
+            out[l] = vec2(px[0], py[0]);
+        return;
+    }
+
+    vf p;
+    memcpy(&p, params, sizeof(p));
+
+    float *xs = scratch;
+    float *ys = scratch + n * BATCH_LANES;
+    for (size_t i = 0; i + 1 < n; i++)
+    {
+        const vf x = px[i] + (px[i+1] - px[i]) * p;
+        const vf y = py[i] + (py[i+1] - py[i]) * p;
+        memcpy(xs + i * BATCH_LANES, &x, sizeof(x));
+        memcpy(ys + i * BATCH_LANES, &y, sizeof(y));
+    }
+
+    for (size_t k = n - 1; k > 1; k--)
+    {
+        vf x0, y0;
+        memcpy(&x0, xs, sizeof(x0));
+        memcpy(&y0, ys, sizeof(y0));
+        for (size_t i = 0; i + 1 < k; i++)
+        {
+            vf x1, y1;
+            memcpy(&x1, xs + (i + 1) * BATCH_LANES, sizeof(x1));
+            memcpy(&y1, ys + (i + 1) * BATCH_LANES, sizeof(y1));
+
+            const vf x = x0 + (x1 - x0) * p;
+            const vf y = y0 + (y1 - y0) * p;
+            memcpy(xs + i * BATCH_LANES, &x, sizeof(x));
+            memcpy(ys + i * BATCH_LANES, &y, sizeof(y));
+
+            x0 = x1;
+            y0 = y1;
+        }
+    }
+
+    vf x, y;
+    memcpy(&x, xs, sizeof(x));
+    memcpy(&y, ys, sizeof(y));
+    for (size_t l = 0; l < BATCH_LANES; l++)
+        out[l] = vec2(x[l], y[l]);
+}
+
+/**
+ * Bernstein/Horner on BATCH_LANES parameters at once, see bernstein_sample.
+ * Lanes below and above p = 0.5 run Horner in opposite directions.
+ * Blocks of a sorted parameter grid almost always fall on one side, then
+ * every step broadcasts a single coefficient. Only a block straddling
+ * 0.5 picks the coefficient of every lane with a mask. The (1-p)^d or
+ * p^d scale is built up in the same loop instead of calling pow.
+ * The lanes are split in two halves of one double register each,
+ * wider vectors would be spilled to the stack on every step.
+ * @param b : Bernstein coefficients from bernstein_prepare
+ * @param params : float BATCH_LANES interpolation values
+ * @param out : Vec2 BATCH_LANES results
+ */
+BATCH_TARGET
+static void BATCH_NAME(bernstein)(const Bernstein *b, const float *params, Vec2 *out)
+{
+    typedef BATCH_NAME(vd) vd;
+    typedef BATCH_NAME(vm) vm;
+#define BATCH_SELECT(mask, a, b) ((vd) (((mask) & (vm) (a)) | (~(mask) & (vm) (b))))
+#define BATCH_HALVES 2
+#define BATCH_HALF (BATCH_LANES / BATCH_HALVES)
+
+    const size_t d = b->n - 1;
+    const vd zero = {0};
+    vd ratio[BATCH_HALVES], base[BATCH_HALVES];
+    vm lower[BATCH_HALVES];
+
+    int lowers = 0;
+    for (size_t h = 0; h < BATCH_HALVES; h++)
+    {
+        BATCH_NAME(vf_half) pf;
+        memcpy(&pf, params + h * BATCH_HALF, sizeof(pf));
+
+        const vd t = __builtin_convertvector(pf, vd);
+        const vd u = 1.0 - t;
+        lower[h] = t < 0.5;
+        ratio[h] = BATCH_SELECT(lower[h], t / u, u / t);
+        base[h] = BATCH_SELECT(lower[h], u, t);
+
+        for (size_t l = 0; l < BATCH_HALF; l++)
+            lowers += lower[h][l] != 0;
+    }
+
+    vd x[BATCH_HALVES], y[BATCH_HALVES], scale[BATCH_HALVES];
+    if (lowers == 0 || lowers == BATCH_LANES)
+    {
+        const ptrdiff_t step = lowers ? -1 : 1;
+        const double *cx = lowers ? b->xs + d : b->xs;
+        const double *cy = lowers ? b->ys + d : b->ys;
+
+        for (size_t h = 0; h < BATCH_HALVES; h++)
+        {
+            x[h] = zero + cx[0];
+            y[h] = zero + cy[0];
+            scale[h] = zero + 1.0;
+        }
+        for (size_t k = 1; k <= d; k++)
+        {
+            const double ck_x = cx[(ptrdiff_t) k * step];
+            const double ck_y = cy[(ptrdiff_t) k * step];
+            for (size_t h = 0; h < BATCH_HALVES; h++)
+            {
+                x[h] = x[h] * ratio[h] + ck_x;
+                y[h] = y[h] * ratio[h] + ck_y;
+                scale[h] *= base[h];
+            }
+        }
+    }
+    else
+    {
+        for (size_t h = 0; h < BATCH_HALVES; h++)
+        {
+            x[h] = BATCH_SELECT(lower[h], zero + b->xs[d], zero + b->xs[0]);
+            y[h] = BATCH_SELECT(lower[h], zero + b->ys[d], zero + b->ys[0]);
+            scale[h] = zero + 1.0;
+        }
+        for (size_t k = 1; k <= d; k++)
+        {
+            for (size_t h = 0; h < BATCH_HALVES; h++)
+            {
+                x[h] = x[h] * ratio[h]
+                    + BATCH_SELECT(lower[h], zero + b->xs[d - k], zero + b->xs[k]);
+                y[h] = y[h] * ratio[h]
+                    + BATCH_SELECT(lower[h], zero + b->ys[d - k], zero + b->ys[k]);
+                scale[h] *= base[h];
+            }
+        }
+    }
+
+    for (size_t h = 0; h < BATCH_HALVES; h++)
+    {
+        x[h] *= scale[h];
+        y[h] *= scale[h];
+        for (size_t l = 0; l < BATCH_HALF; l++)
+            out[h * BATCH_HALF + l] = vec2((float) x[h][l], (float) y[h][l]);
+    }
+
+#undef BATCH_HALF
+#undef BATCH_HALVES
+#undef BATCH_SELECT
+}
+
+#undef BATCH_LANES
+#undef BATCH_NAME
+#undef BATCH_TARGET
@@ -0,0 +1,224 @@
+/* Fixed point evaluation, see bezier.h
+ *
+ * Nothing but integer adds, multiplies and shifts between the conversion
+ * of the control points and the conversion of the results, so the same
+ * inputs give the same bits on every machine, whatever its FPU does.
+ */
+
+#include "bezier.h"
+
+/* Fractional bits the forward differences carry on top of the 16.16
+ * points, without them the rounding of the third difference grows
+ * with the cube of the steps */
+#define FORWARD_EXTRA_SHIFT 24
+
+/**
+ * Converts to 16.16, clamped to the int32_t range
+ * @param v : float Coordinate, within +-32767 to be represented exactly
+ */
+int32_t bezier_to_fixed(float v)
+{
+    const float limit = 32767.0f;
+    if (!(v > -limit))
+        v = -limit;
+    if (v > limit)
+        v = limit;
+    /* Exact in double, + 0.5 and the truncation round half away from 0 */
+    const double fixed = (double) v * BEZIER_FIXED_ONE;
+    return (int32_t) (fixed < 0.0 ? fixed - 0.5 : fixed + 0.5);
+}
+
+float bezier_from_fixed(int32_t v)
+{
+    return (float) v / (float) BEZIER_FIXED_ONE;
+}
+
+/* Fractional bits of the params, as many as the products of the
+ * lerps leave room for: a 16 bit param alone is off by a few
+ * hundredths of a pixel on a screen sized curve */
+#define PARAM_SHIFT 30
+
+/* Parameter in [0, 1] as 2.30 */
+static int32_t fixed_param(float p)
+{
+    const int32_t one = (int32_t) 1 << PARAM_SHIFT;
+    if (!(p > 0.0f))
+        return 0;
+    if (p >= 1.0f)
+        return one;
+    return (int32_t) ((double) p * one + 0.5);
+}
+
+/* Divides rounding half away from 0, the only rounding C pins down
+ * for negative values is the truncation of / */
+static int64_t fixed_div(int64_t a, int64_t b)
+{
+    return a >= 0 ? (a + b / 2) / b : -((-a + b / 2) / b);
+}
+
+/* Rounds to nearest with an arithmetic shift, which every compiler we
+ * build with uses for >> of negative values, gcc and clang document it */
+static int32_t fixed_lerp(int32_t a, int32_t b, int32_t t)
+{
+    const int64_t half = (int64_t) 1 << (PARAM_SHIFT - 1);
+    return a + (int32_t) ((((int64_t) b - a) * t + half) >> PARAM_SHIFT);
+}
+
+/**
+ * de Casteljau in 16.16, O(n^2) per sample. The points are converted
+ * as the first level reads them.
+ * @param xs : Vec2Fixed Scratch for n - 1 points
+ * @return the point at p, the origin if there are no points
+ */
+Vec2 beziern_sample_fixed(const Vec2 *ps, Vec2Fixed *xs, size_t n, float p)
+{
+    if (n == 0)
+        return vec2(0.0f, 0.0f);
+
+    const int32_t t = fixed_param(p);
+    int32_t x = bezier_to_fixed(ps[0].x);
+    int32_t y = bezier_to_fixed(ps[0].y);
+    if (n == 1)
+        return vec2(bezier_from_fixed(x), bezier_from_fixed(y));
+
+    for (size_t i = 0; i < n - 1; i++)
+    {
+        const int32_t next_x = bezier_to_fixed(ps[i+1].x);
+        const int32_t next_y = bezier_to_fixed(ps[i+1].y);
+        xs[i].x = fixed_lerp(x, next_x, t);
+        xs[i].y = fixed_lerp(y, next_y, t);
+        x = next_x;
+        y = next_y;
+    }
+    n--;
+
+    while (n > 1)
+    {
+        for (size_t i = 0; i < n - 1; i++)
+        {
+            xs[i].x = fixed_lerp(xs[i].x, xs[i+1].x, t);
+            xs[i].y = fixed_lerp(xs[i].y, xs[i+1].y, t);
+        }
+        n--;
+    }
+    return vec2(bezier_from_fixed(xs[0].x), bezier_from_fixed(xs[0].y));
+}
+
+/* bezier_chain_sample with the segment evaluated in 16.16 */
+Vec2 bezier_chain_sample_fixed(const Vec2 *ps, size_t n, float u)
+{
+    if (n == 1)
+        return ps[0];
+
+    const size_t segment = bezier_chain_segment(n, u);
+    const size_t left = n - segment * 3;
+    Vec2Fixed xs[4];
+    return beziern_sample_fixed(ps + segment * 3, xs, left < 4 ? left : 4,
+            u - (float) segment);
+}
+
+/* One axis of a segment as integer power basis coefficients,
+ * B(t) = a t^3 + b t^2 + c t + d */
+typedef struct Forward
+{
+    int64_t p;
+    int64_t d1;
+    int64_t d2;
+    int64_t d3;
+} Forward;
+
+static Forward forward_prepare(const int32_t *q, size_t m, int64_t steps)
+{
+    int64_t a = 0;
+    int64_t b = 0;
+    int64_t c = 0;
+    const int64_t d = q[0];
+    if (m == 2)
+    {
+        c = (int64_t) q[1] - q[0];
+    }
+    else if (m == 3)
+    {
+        b = (int64_t) q[0] - 2 * (int64_t) q[1] + q[2];
+        c = 2 * ((int64_t) q[1] - q[0]);
+    }
+    else if (m == 4)
+    {
+        a = -(int64_t) q[0] + 3 * (int64_t) q[1] - 3 * (int64_t) q[2] + q[3];
+        b = 3 * (int64_t) q[0] - 6 * (int64_t) q[1] + 3 * (int64_t) q[2];
+        c = 3 * ((int64_t) q[1] - q[0]);
+    }
+
+    /* With h = 1 / steps the differences are
+     * a h^3 + b h^2 + c h, 6 a h^3 + 2 b h^2 and 6 a h^3 */
+    const int64_t one = (int64_t) 1 << FORWARD_EXTRA_SHIFT;
+    const int64_t ah = fixed_div(a * one, steps * steps * steps);
+    const int64_t bh = fixed_div(b * one, steps * steps);
+    const int64_t ch = fixed_div(c * one, steps);
+    const Forward f = {
+        d * one,
+        ah + bh + ch,
+        6 * ah + 2 * bh,
+        6 * ah,
+    };
+    return f;
+}
+
+static void forward_step(Forward *f)
+{
+    f->p += f->d1;
+    f->d1 += f->d2;
+    f->d2 += f->d3;
+}
+
+static float forward_value(const Forward *f)
+{
+    /* A power of 2, the product is exact */
+    const double scale = 1.0 / (double) ((int64_t) 1 << (BEZIER_FIXED_SHIFT + FORWARD_EXTRA_SHIFT));
+    return (float) ((double) f->p * scale);
+}
+
+/**
+ * Integer forward differencing of a line, quadratic or cubic at the
+ * params i / steps, O(1) per sample. The rounding of the differences
+ * adds up with the cube of the steps, above BEZIER_FORWARD_MAX_STEPS
+ * every sample is evaluated on its own instead.
+ * @param seg : Vec2 Control points of the segment
+ * @param m : size_t Number of points, at most 4
+ * @param steps : size_t Samples per unit of param
+ * @param first : size_t Index of the first param written to out
+ * @param count : size_t Number of samples written to out
+ */
+void bezier_forward_fixed(const Vec2 *seg, size_t m, size_t steps,
+        size_t first, size_t count, Vec2 *out)
+{
+    if (steps > BEZIER_FORWARD_MAX_STEPS)
+    {
+        Vec2Fixed xs[4];
+        for (size_t i = 0; i < count; i++)
+            out[i] = beziern_sample_fixed(seg, xs, m, (float) (first + i) / (float) steps);
+        return;
+    }
+
+    int32_t qx[4];
+    int32_t qy[4];
+    for (size_t i = 0; i < m; i++)
+    {
+        qx[i] = bezier_to_fixed(seg[i].x);
+        qy[i] = bezier_to_fixed(seg[i].y);
+    }
+
+    Forward fx = forward_prepare(qx, m, (int64_t) steps);
+    Forward fy = forward_prepare(qy, m, (int64_t) steps);
+    for (size_t i = 0; i < first; i++)
+    {
+        forward_step(&fx);
+        forward_step(&fy);
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = vec2(forward_value(&fx), forward_value(&fy));
+        forward_step(&fx);
+        forward_step(&fy);
+    }
+}
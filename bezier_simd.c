@@ -0,0 +1,195 @@
+/* Batched, SIMD evaluation of many parameters at once, see bezier.h
+ *
+ * Every instruction set gets its own copy of the kernels in
+ * bezier_batch.h. Which copy runs is decided at runtime, the scalar
+ * copy is always available as a fallback.
+ */
+
+#include <string.h>
+
+#include "bezier.h"
+
+/* Scalar fallbacks, one parameter at a time */
+
+static void decasteljau_scalar(const float *px, const float *py, size_t n,
+        const float *params, Vec2 *out, float *scratch)
+{
+    const float p = params[0];
+    if (n == 1)
+    {
+        *out = vec2(px[0], py[0]);
+        return;
+    }
+
+    float *xs = scratch;
+    float *ys = scratch + n;
+    for (size_t i = 0; i + 1 < n; i++)
+    {
+        xs[i] = lerpf(px[i], px[i+1], p);
+        ys[i] = lerpf(py[i], py[i+1], p);
+    }
+    for (size_t k = n - 1; k > 1; k--)
+    {
+        for (size_t i = 0; i + 1 < k; i++)
+        {
+            xs[i] = lerpf(xs[i], xs[i+1], p);
+            ys[i] = lerpf(ys[i], ys[i+1], p);
+        }
+    }
+    *out = vec2(xs[0], ys[0]);
+}
+
+static void bernstein_scalar(const Bernstein *b, const float *params, Vec2 *out)
+{
+    *out = bernstein_sample(b, params[0]);
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_HAVE_X86
+
+#define BATCH_LANES 4
+#define BATCH_NAME(name) name##_sse
+#define BATCH_TARGET __attribute__((target("sse2")))
+#include "bezier_batch.h"
+
+#define BATCH_LANES 8
+#define BATCH_NAME(name) name##_avx2
+#define BATCH_TARGET __attribute__((target("avx2")))
+#include "bezier_batch.h"
+
+#define BATCH_LANES 16
+#define BATCH_NAME(name) name##_avx512
+#define BATCH_TARGET __attribute__((target("avx512f")))
+#include "bezier_batch.h"
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__)
+#define BATCH_HAVE_NEON
+
+#define BATCH_LANES 4
+#define BATCH_NAME(name) name##_neon
+#define BATCH_TARGET
+#include "bezier_batch.h"
+#endif
+
+typedef struct BatchKernels
+{
+    size_t lanes;
+    void (*decasteljau)(const float *px, const float *py, size_t n,
+            const float *params, Vec2 *out, float *scratch);
+    void (*bernstein)(const Bernstein *b, const float *params, Vec2 *out);
+} BatchKernels;
+
+/* Paths that were not compiled in have 0 lanes */
+static const BatchKernels batch_kernels[BATCH_PATHS_COUNT] = {
+    [BATCH_SCALAR] = {1, decasteljau_scalar, bernstein_scalar},
+#ifdef BATCH_HAVE_NEON
+    [BATCH_NEON] = {4, decasteljau_neon, bernstein_neon},
+#endif
+#ifdef BATCH_HAVE_X86
+    [BATCH_SSE] = {4, decasteljau_sse, bernstein_sse},
+    [BATCH_AVX2] = {8, decasteljau_avx2, bernstein_avx2},
+    [BATCH_AVX512] = {16, decasteljau_avx512, bernstein_avx512},
+#endif
+};
+
+const char *batch_path_names[BATCH_PATHS_COUNT] = {
+    [BATCH_SCALAR] = "scalar",
+    [BATCH_NEON] = "neon",
+    [BATCH_SSE] = "sse",
+    [BATCH_AVX2] = "avx2",
+    [BATCH_AVX512] = "avx512",
+};
+
+int batch_path_supported(BatchPath path)
+{
+    if (batch_kernels[path].lanes == 0)
+        return 0;
+
+#ifdef BATCH_HAVE_X86
+    switch (path)
+    {
+        case BATCH_SSE:
+            return __builtin_cpu_supports("sse2");
+        case BATCH_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case BATCH_AVX512:
+            return __builtin_cpu_supports("avx512f");
+        default:
+            break;
+    }
+#endif
+    return 1;
+}
+
+BatchPath batch_path_best(void)
+{
+    for (int path = BATCH_PATHS_COUNT - 1; path > BATCH_SCALAR; path--)
+    {
+        if (batch_path_supported((BatchPath) path))
+            return (BatchPath) path;
+    }
+    return BATCH_SCALAR;
+}
+
+size_t batch_path_lanes(BatchPath path)
+{
+    return batch_kernels[path].lanes;
+}
+
+void bezier_soa(const Vec2 *ps, size_t n, float *px, float *py)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        px[i] = ps[i].x;
+        py[i] = ps[i].y;
+    }
+}
+
+/* Pads the last incomplete block with copies of the last parameter */
+static void batch_tail(const float *params, size_t count, size_t lanes, float *tail)
+{
+    for (size_t l = 0; l < lanes; l++)
+        tail[l] = params[l < count ? l : count - 1];
+}
+
+void beziern_sample_batch(BatchPath path,
+        const float *px, const float *py, size_t n,
+        const float *params, size_t count, Vec2 *out, float *scratch)
+{
+    const BatchKernels *kernels = &batch_kernels[path];
+    const size_t lanes = kernels->lanes;
+
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes)
+        kernels->decasteljau(px, py, n, params + i, out + i, scratch);
+
+    if (i < count)
+    {
+        float tail[BATCH_MAX_LANES];
+        Vec2 tail_out[BATCH_MAX_LANES];
+        batch_tail(params + i, count - i, lanes, tail);
+        kernels->decasteljau(px, py, n, tail, tail_out, scratch);
+        memcpy(out + i, tail_out, (count - i) * sizeof(Vec2));
+    }
+}
+
+void bernstein_sample_batch(BatchPath path, const Bernstein *b,
+        const float *params, size_t count, Vec2 *out)
+{
+    const BatchKernels *kernels = &batch_kernels[path];
+    const size_t lanes = kernels->lanes;
+
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes)
+        kernels->bernstein(b, params + i, out + i);
+
+    if (i < count)
+    {
+        float tail[BATCH_MAX_LANES];
+        Vec2 tail_out[BATCH_MAX_LANES];
+        batch_tail(params + i, count - i, lanes, tail);
+        kernels->bernstein(b, tail, tail_out);
+        memcpy(out + i, tail_out, (count - i) * sizeof(Vec2));
+    }
+}
@@ -0,0 +1,641 @@
+/* Headless checks of the kernels, the curves and the file formats
+ *
+ * Compares every evaluator with a double precision de Casteljau
+ * reference, drags curves and compares the moved samples with a fresh
+ * resample, and writes scenes, point lists and journals to temporary
+ * files to read them back. Prints every failed check and exits with
+ * status 1 if there was any.
+ *
+ * Usage: bezier_check
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "SDL.h"
+
+#include "bezier.h"
+#include "curve.h"
+#include "journal.h"
+#include "pool.h"
+#include "scene.h"
+#include "text.h"
+
+#define CHECK_SEED 69
+#define CHECK_MAX_POINTS 256
+#define CHECK_MAX_SAMPLES 100001
+/* Largest deviation from the reference allowed, in pixels */
+#define CHECK_TOLERANCE 1e-3
+/* Drags add up rounding errors until the curve settles */
+#define CHECK_DRAG_TOLERANCE 1e-2
+
+#define CHECK_WIDTH 640.0f
+#define CHECK_HEIGHT 480.0f
+#define CHECK_CELL_SIZE 32.0f
+
+#define CHECK_FILE "bezier_check.tmp"
+
+#define ARRAY_LEN(xs) (sizeof(xs) / sizeof((xs)[0]))
+
+int failures = 0;
+
+#define CHECK(cond, ...) check((cond), #cond, __FILE__, __LINE__, __VA_ARGS__)
+
+void check(int ok, const char *cond, const char *file, int line, const char *format, ...)
+{
+    if (ok)
+        return;
+
+    failures++;
+    printf("%s:%d: check %s failed: ", file, line, cond);
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+}
+
+float randf(float max)
+{
+    return (float) rand() / (float) RAND_MAX * max;
+}
+
+void random_points(Vec2 *ps, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        ps[i] = vec2(randf(CHECK_WIDTH), randf(CHECK_HEIGHT));
+}
+
+/* Extended precision de Casteljau the evaluators are compared against */
+void reference_sample(const Vec2 *ps, size_t n, float p, double *x, double *y)
+{
+    static double rx[CHECK_MAX_POINTS], ry[CHECK_MAX_POINTS];
+    for (size_t i = 0; i < n; i++)
+    {
+        rx[i] = ps[i].x;
+        ry[i] = ps[i].y;
+    }
+    for (; n > 1; n--)
+    {
+        for (size_t i = 0; i < n - 1; i++)
+        {
+            rx[i] += (rx[i+1] - rx[i]) * p;
+            ry[i] += (ry[i+1] - ry[i]) * p;
+        }
+    }
+    *x = rx[0];
+    *y = ry[0];
+}
+
+double reference_error(const Vec2 *ps, size_t n, float p, Vec2 sample)
+{
+    double x, y;
+    reference_sample(ps, n, p, &x, &y);
+    return fmax(fabs(sample.x - x), fabs(sample.y - y));
+}
+
+int vec2_finite(Vec2 v)
+{
+    return isfinite(v.x) && isfinite(v.y);
+}
+
+Vec2 ps[CHECK_MAX_POINTS];
+Vec2 xs[CHECK_MAX_POINTS];
+Vec2Fixed xs_fixed[CHECK_MAX_POINTS];
+float px[CHECK_MAX_POINTS], py[CHECK_MAX_POINTS];
+float scratch[BATCH_SCRATCH_FLOATS(CHECK_MAX_POINTS)];
+Bernstein bernstein;
+float params[CHECK_MAX_SAMPLES];
+Vec2 out[CHECK_MAX_SAMPLES];
+Vec2 split[CHECK_MAX_SAMPLES];
+
+const size_t degrees[] = {1, 2, 3, 4, 5, 8, 9, 15, 63, 255};
+
+/* The de Casteljau and Bernstein evaluators at spread out params */
+void check_evaluators(void)
+{
+    const Vec2 none = beziern_sample(ps, NULL, 0, 0.5f);
+    const Vec2 none_fixed = beziern_sample_fixed(ps, xs_fixed, 0, 0.5f);
+    CHECK(none.x == 0.0f && none.y == 0.0f && none_fixed.x == 0.0f && none_fixed.y == 0.0f,
+            "de Casteljau of no points isn't the origin");
+
+    const size_t count = 1001;
+    for (size_t i = 0; i < count; i++)
+        params[i] = (float) i / (float) (count - 1);
+
+    for (size_t d = 0; d < ARRAY_LEN(degrees); d++)
+    {
+        const size_t n = degrees[d] + 1;
+        random_points(ps, n);
+        bernstein_prepare(&bernstein, ps, n);
+        bezier_soa(ps, n, px, py);
+
+        double error = 0.0, error_fixed = 0.0, error_bernstein = 0.0;
+        for (size_t i = 0; i < count; i++)
+        {
+            error = fmax(error, reference_error(ps, n, params[i],
+                    beziern_sample(ps, xs, n, params[i])));
+            error_fixed = fmax(error_fixed, reference_error(ps, n, params[i],
+                    beziern_sample_fixed(ps, xs_fixed, n, params[i])));
+            error_bernstein = fmax(error_bernstein, reference_error(ps, n, params[i],
+                    bernstein_sample(&bernstein, params[i])));
+            if (n <= BEZIER_UNROLLED_MAX_POINTS)
+                error = fmax(error, reference_error(ps, n, params[i],
+                        beziern_sample(ps, NULL, n, params[i])));
+        }
+        CHECK(error < CHECK_TOLERANCE, "de Casteljau of degree %zu is off by %g", n - 1, error);
+        CHECK(error_fixed < CHECK_TOLERANCE,
+                "fixed point de Casteljau of degree %zu is off by %g", n - 1, error_fixed);
+        CHECK(error_bernstein < CHECK_TOLERANCE,
+                "Bernstein of degree %zu is off by %g", n - 1, error_bernstein);
+
+        for (BatchPath path = BATCH_SCALAR; path < BATCH_PATHS_COUNT; path++)
+        {
+            if (!batch_path_supported(path))
+                continue;
+
+            beziern_sample_batch(path, px, py, n, params, count, out, scratch);
+            double error_batch = 0.0;
+            for (size_t i = 0; i < count; i++)
+                error_batch = fmax(error_batch, reference_error(ps, n, params[i], out[i]));
+            CHECK(error_batch < CHECK_TOLERANCE, "%s de Casteljau of degree %zu is off by %g",
+                    batch_path_names[path], n - 1, error_batch);
+
+            bernstein_sample_batch(path, &bernstein, params, count, out);
+            error_batch = 0.0;
+            for (size_t i = 0; i < count; i++)
+                error_batch = fmax(error_batch, reference_error(ps, n, params[i], out[i]));
+            CHECK(error_batch < CHECK_TOLERANCE, "%s Bernstein of degree %zu is off by %g",
+                    batch_path_names[path], n - 1, error_batch);
+        }
+    }
+}
+
+typedef void (*ForwardKernel)(const Vec2 *seg, size_t m, size_t steps,
+        size_t first, size_t count, Vec2 *out);
+
+/**
+ * Forward differencing over the whole grid, also taken in uneven pieces,
+ * which have to give the very same samples
+ * @param exact_end : int Whether the last sample is the last point exactly,
+ * fixed point rounds it to 1/65536
+ */
+void check_forward_kernel(const char *name, ForwardKernel forward, int exact_end)
+{
+    const size_t step_counts[] = {1, 10, 1000, BEZIER_FORWARD_MAX_STEPS, 100000};
+    for (size_t m = 2; m <= 4; m++)
+    {
+        random_points(ps, m);
+        for (size_t s = 0; s < ARRAY_LEN(step_counts); s++)
+        {
+            const size_t steps = step_counts[s];
+            forward(ps, m, steps, 0, steps + 1, out);
+
+            double error = 0.0;
+            for (size_t i = 0; i <= steps; i++)
+                error = fmax(error, reference_error(ps, m, (float) i / (float) steps, out[i]));
+            CHECK(error < CHECK_TOLERANCE, "%s of %zu points at %zu steps is off by %g",
+                    name, m, steps, error);
+            CHECK(!exact_end || (out[steps].x == ps[m-1].x && out[steps].y == ps[m-1].y),
+                    "%s of %zu points at %zu steps misses the last point", name, m, steps);
+
+            for (size_t first = 0; first <= steps; first += 777)
+            {
+                const size_t count = first + 777 <= steps + 1 ? 777 : steps + 1 - first;
+                forward(ps, m, steps, first, count, split + first);
+            }
+            CHECK(memcmp(out, split, (steps + 1) * sizeof(Vec2)) == 0,
+                    "%s of %zu points at %zu steps depends on the split", name, m, steps);
+        }
+    }
+}
+
+/* Every segment of a cubic chain matches its own cubic */
+void check_chain(void)
+{
+    const size_t n = 3 * 7 + 1;
+    random_points(ps, n);
+    const size_t segments = bezier_chain_segments(n);
+    CHECK(segments == 7, "a chain of %zu points has %zu segments", n, segments);
+
+    double error = 0.0, error_fixed = 0.0;
+    const size_t count = 7001;
+    for (size_t i = 0; i < count; i++)
+    {
+        const float u = (float) i * (float) segments / (float) (count - 1);
+        const size_t segment = bezier_chain_segment(n, u);
+        const float p = u - (float) segment;
+        double x, y;
+        reference_sample(ps + 3 * segment, 4, p, &x, &y);
+
+        const Vec2 sample = bezier_chain_sample(ps, n, u);
+        const Vec2 sample_fixed = bezier_chain_sample_fixed(ps, n, u);
+        error = fmax(error, fmax(fabs(sample.x - x), fabs(sample.y - y)));
+        error_fixed = fmax(error_fixed, fmax(fabs(sample_fixed.x - x), fabs(sample_fixed.y - y)));
+    }
+    CHECK(error < CHECK_TOLERANCE, "the chain is off by %g", error);
+    CHECK(error_fixed < CHECK_TOLERANCE, "the fixed point chain is off by %g", error_fixed);
+}
+
+/**
+ * Drags control points of a curve of n points around, which moves the
+ * samples incrementally, and compares them to the resampled curve
+ * @param s : float Sample step of the curve
+ */
+void check_drag(size_t n, float s, int piecewise)
+{
+    Curve *curve = curve_create(batch_path_best(), CHECK_WIDTH, CHECK_HEIGHT, CHECK_CELL_SIZE);
+    Vec2 *points = malloc(n * sizeof(Vec2));
+    CHECK(curve != NULL && points != NULL, "no memory for a curve of %zu points", n);
+    if (curve == NULL || points == NULL)
+    {
+        curve_destroy(curve);
+        free(points);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++)
+        points[i] = vec2(randf(CHECK_WIDTH), randf(CHECK_HEIGHT));
+    CHECK(curve_append(curve, points, n), "couldn't add %zu points", n);
+    curve_update(curve, NULL, s, piecewise, 0, 0, 1.0f);
+
+    const size_t moved[] = {0, 1, n / 2, n / 2, n - 2, n - 1};
+    for (size_t i = 0; i < ARRAY_LEN(moved); i++)
+        curve_move(curve, moved[i], vec2(randf(CHECK_WIDTH), randf(CHECK_HEIGHT)));
+
+    const size_t count = curve->cache.count + 1;
+    Vec2 *dragged = malloc(count * sizeof(Vec2));
+    if (dragged != NULL)
+    {
+        memcpy(dragged, curve->cache.samples, count * sizeof(Vec2));
+        curve_settle(curve);
+        curve_update(curve, NULL, s, piecewise, 0, 0, 1.0f);
+        CHECK(curve->cache.count + 1 == count, "settling a curve changed its sample count");
+
+        double error = 0.0;
+        int finite = 1;
+        for (size_t i = 0; i < count; i++)
+        {
+            finite = finite && vec2_finite(dragged[i]);
+            error = fmax(error, fabs(dragged[i].x - curve->cache.samples[i].x));
+            error = fmax(error, fabs(dragged[i].y - curve->cache.samples[i].y));
+        }
+        CHECK(finite, "dragging a curve of %zu points left samples that aren't finite", n);
+        /* The segments of a chain are resampled the same way they are dragged */
+        CHECK(piecewise ? error == 0.0 : error < CHECK_DRAG_TOLERANCE,
+                "dragged samples of a curve of %zu points are off by %g", n, error);
+    }
+
+    free(dragged);
+    free(points);
+    curve_destroy(curve);
+}
+
+/**
+ * Samples a curve of n points on a pool and inline, which take their
+ * scratch from different places but have to give the same samples,
+ * then subdivides it adaptively
+ */
+void check_scratch(Pool *pool, size_t n, int piecewise)
+{
+    Curve *curve = curve_create(batch_path_best(), CHECK_WIDTH, CHECK_HEIGHT, CHECK_CELL_SIZE);
+    CHECK(curve != NULL, "no memory for a curve of %zu points", n);
+    if (curve == NULL)
+        return;
+
+    for (size_t i = 0; i < n; i++)
+        curve_push(curve, vec2(randf(CHECK_WIDTH), randf(CHECK_HEIGHT)));
+    curve_update(curve, pool, 0.001f, piecewise, 0, 0, 1.0f);
+    const size_t count = curve->cache.count + 1;
+    memcpy(out, curve->cache.samples, count * sizeof(Vec2));
+    curve_invalidate(curve);
+    curve_update(curve, NULL, 0.001f, piecewise, 0, 0, 1.0f);
+    CHECK(curve->cache.count + 1 == count
+            && memcmp(out, curve->cache.samples, count * sizeof(Vec2)) == 0,
+            "a curve of %zu points sampled on the pool differs from inline", n);
+
+    curve_update(curve, pool, 0.001f, piecewise, 0, 1, 0.5f);
+    const Vec2 last = curve->cache.samples[curve->cache.count];
+    CHECK(curve->cache.count > 0 && last.x == curve->ps[n-1].x && last.y == curve->ps[n-1].y,
+            "the subdivision of a curve of %zu points doesn't end at its last point", n);
+
+    curve_destroy(curve);
+}
+
+/* Arc length of a straight curve of n evenly spaced points */
+void check_arc_length(size_t n, int piecewise)
+{
+    Curve *curve = curve_create(batch_path_best(), CHECK_WIDTH, CHECK_HEIGHT, CHECK_CELL_SIZE);
+    CHECK(curve != NULL, "no memory for a curve of %zu points", n);
+    if (curve == NULL)
+        return;
+
+    for (size_t i = 0; i < n; i++)
+        curve_push(curve, vec2(10.0f + CHECK_WIDTH * (float) i / (float) (n - 1), 20.0f));
+    curve_arc_update(curve, NULL, piecewise);
+    const float length = curve_arc_length(curve);
+    CHECK(fabsf(length - CHECK_WIDTH) < CHECK_WIDTH * 1e-4f,
+            "a straight curve of %zu points is %g long", n, length);
+    const Vec2 middle = curve_arc_point(curve, length / 2.0f);
+    CHECK(fabsf(middle.x - (10.0f + CHECK_WIDTH / 2.0f)) < 1e-2f && middle.y == 20.0f,
+            "the middle of a straight curve of %zu points is at %g, %g", n, middle.x, middle.y);
+
+    curve_destroy(curve);
+}
+
+/**
+ * Draws a chain of n points smaller and smaller, every level of detail
+ * has to hold its steps in every segment and end at the last point
+ */
+void check_lod(size_t n)
+{
+    Curve *curve = curve_create(batch_path_best(), CHECK_WIDTH, CHECK_HEIGHT, CHECK_CELL_SIZE);
+    CHECK(curve != NULL, "no memory for a curve of %zu points", n);
+    if (curve == NULL)
+        return;
+
+    for (size_t i = 0; i < n; i++)
+        curve_push(curve, vec2(randf(CHECK_WIDTH), randf(CHECK_HEIGHT)));
+    const size_t segments = bezier_chain_segments(n);
+
+    int levels = 0;
+    for (float scale = 1.0f; scale > 1e-4f; scale /= 2.0f)
+    {
+        const int level = curve_lod_level(curve, 0.001f, 1, 0, scale);
+        curve_update_lod(curve, NULL, level, 0.001f, 1, 0, 0, 1.0f);
+        const SampleCache *cache = curve_lod_cache(curve, level);
+        const Vec2 last = cache->samples[cache->count];
+        CHECK(level < 0 || cache->count == ((size_t) LOD_BASE_STEPS << level) * segments,
+                "level %d of a chain of %zu points has %zu samples", level, n, cache->count);
+        CHECK(last.x == curve->ps[n-1].x && last.y == curve->ps[n-1].y,
+                "level %d of a chain of %zu points doesn't end at its last point", level, n);
+        levels += level >= 0;
+    }
+    CHECK(levels > 0, "a chain of %zu points is never drawn at a level of detail", n);
+
+    curve_destroy(curve);
+}
+
+/* Only curves ending on their first point are closed, and filled */
+void check_closed(void)
+{
+    Curve *curve = curve_create(BATCH_SCALAR, CHECK_WIDTH, CHECK_HEIGHT, CHECK_CELL_SIZE);
+    CHECK(curve != NULL, "no memory for a curve");
+    if (curve == NULL)
+        return;
+
+    curve_push(curve, vec2(100.0f, 100.0f));
+    curve_push(curve, vec2(100.0f, 100.0f));
+    CHECK(!curve_closed(curve, 5.0f), "a curve of 2 points is closed");
+    curve_push(curve, vec2(300.0f, 100.0f));
+    curve_push(curve, vec2(200.0f, 300.0f));
+    CHECK(!curve_closed(curve, 5.0f), "an open curve is closed");
+    curve_push(curve, vec2(104.0f, 96.0f));
+    CHECK(curve_closed(curve, 5.0f), "a curve ending on its first point isn't closed");
+    curve_move(curve, 4, vec2(106.0f, 100.0f));
+    CHECK(!curve_closed(curve, 5.0f), "a curve ending next to its first point is closed");
+
+    curve_destroy(curve);
+}
+
+Scene *check_scene_create(void)
+{
+    Scene *scene = scene_create(BATCH_SCALAR, CHECK_WIDTH, CHECK_HEIGHT, CHECK_CELL_SIZE);
+    CHECK(scene != NULL, "no memory for a scene");
+    return scene;
+}
+
+/* Whether both scenes have the same curves with the same points */
+int scenes_equal(const Scene *a, const Scene *b)
+{
+    if (a->count != b->count)
+        return 0;
+    for (size_t i = 0; i < a->count; i++)
+    {
+        const Curve *curve = a->curves[i];
+        if (curve->count != b->curves[i]->count
+            || memcmp(curve->ps, b->curves[i]->ps, curve->count * sizeof(Vec2)) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+void check_scene_file(void)
+{
+    Scene *scene = check_scene_create();
+    Scene *loaded = check_scene_create();
+    if (scene == NULL || loaded == NULL)
+    {
+        scene_destroy(scene);
+        scene_destroy(loaded);
+        return;
+    }
+
+    /* Curves longer than a file chunk too. Empty curves aren't kept,
+     * the next curve loaded goes into them. */
+    const size_t counts[] = {5, 10005, 20005};
+    for (size_t c = 0; c < ARRAY_LEN(counts); c++)
+    {
+        Curve *curve = c == 0 ? scene_active(scene) : scene_add(scene);
+        CHECK(curve != NULL, "couldn't add curve %zu", c);
+        for (size_t i = 0; curve != NULL && i < counts[c]; i++)
+            curve_push(curve, vec2(randf(CHECK_WIDTH), randf(CHECK_HEIGHT)));
+    }
+
+    CHECK(scene_save(scene, CHECK_FILE), "couldn't save the scene: %s", SDL_GetError());
+    CHECK(scene_load(loaded, CHECK_FILE), "couldn't load the scene: %s", SDL_GetError());
+    CHECK(scenes_equal(scene, loaded), "the loaded scene isn't the saved one");
+
+    scene_destroy(scene);
+    scene_destroy(loaded);
+    remove(CHECK_FILE);
+}
+
+int write_file(const char *text)
+{
+    FILE *file = fopen(CHECK_FILE, "wb");
+    if (file == NULL)
+        return 0;
+    const int ok = fputs(text, file) >= 0;
+    return fclose(file) == 0 && ok;
+}
+
+/* Whether the curve has exactly the expected points */
+int curve_is(const Curve *curve, const Vec2 *expected, size_t count)
+{
+    if (curve->count != count)
+        return 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (fabsf(curve->ps[i].x - expected[i].x) > 1e-4f
+            || fabsf(curve->ps[i].y - expected[i].y) > 1e-4f)
+            return 0;
+    }
+    return 1;
+}
+
+/* Imports text into an empty scene, compares the curves it gets */
+void check_import(int (*import)(Scene *scene, const char *file), const char *text,
+        const Vec2 *expected, const size_t *counts, size_t curves)
+{
+    Scene *scene = check_scene_create();
+    if (scene == NULL)
+        return;
+
+    CHECK(write_file(text), "couldn't write %s", CHECK_FILE);
+    const int ok = import(scene, CHECK_FILE);
+    CHECK(ok, "couldn't import \"%s\": %s", text, SDL_GetError());
+    if (ok)
+    {
+        /* The first curve goes into the empty one the scene starts with */
+        CHECK(scene->count == curves, "\"%s\" gave %zu curves", text, scene->count);
+        for (size_t c = 0; c < curves && c < scene->count; c++)
+        {
+            CHECK(curve_is(scene->curves[c], expected, counts[c]),
+                    "curve %zu of \"%s\" has the wrong points", c, text);
+            expected += counts[c];
+        }
+    }
+
+    scene_destroy(scene);
+    remove(CHECK_FILE);
+}
+
+void check_text(void)
+{
+    const Vec2 csv[] = {
+        {1.0f, 2.0f}, {-3.5f, 100.0f}, {0.25f, 4.0f},
+        {10.0f, 20.0f}, {30.0f, 40.0f},
+    };
+    const size_t csv_counts[] = {3, 2};
+    check_import(text_import_csv,
+            "# x, y\n1, 2\n-3.5;1e2\n  +.25 4 ignored\n\n\n10,20\r\n# more\n30,40",
+            csv, csv_counts, ARRAY_LEN(csv_counts));
+
+    /* Lines become cubics with their control points at the thirds */
+    const Vec2 svg[] = {
+        {0.0f, 0.0f}, {10.0f, 0.0f}, {20.0f, 0.0f}, {30.0f, 0.0f},
+        {31.0f, 2.0f}, {3.0f, 4.0f}, {5.0f, 6.0f},
+        {5.0f, 4.0f}, {5.0f, 2.0f}, {5.0f, 0.0f},
+        {100.0f, 100.0f}, {200.0f / 3.0f, 100.0f}, {100.0f / 3.0f, 100.0f}, {0.0f, 100.0f},
+        {100.0f / 3.0f, 100.0f}, {200.0f / 3.0f, 100.0f}, {100.0f, 100.0f},
+    };
+    const size_t svg_counts[] = {10, 7};
+    check_import(text_import_svg,
+            "<svg><path fill='none' d=\"M0 0H30c1,2 -27,4 -25,6V0\"/>"
+            "<path d='M 100 100 L 0 100 Z'/></svg>",
+            svg, svg_counts, ARRAY_LEN(svg_counts));
+}
+
+void check_journal(void)
+{
+    SDL_Event events[4];
+    memset(events, 0, sizeof(events));
+    events[0].type = SDL_MOUSEBUTTONDOWN;
+    events[0].button.button = SDL_BUTTON_LEFT;
+    events[0].button.x = 10;
+    events[0].button.y = -20;
+    events[1].type = SDL_MOUSEMOTION;
+    events[1].motion.x = 40000;
+    events[1].motion.y = 300;
+    events[2].type = SDL_MOUSEWHEEL;
+    events[2].wheel.y = -3;
+    events[3].type = SDL_KEYDOWN;
+    events[3].key.keysym.sym = SDLK_HOME;
+    const SDL_Keymod mods[4] = {KMOD_NONE, KMOD_SHIFT, KMOD_CTRL, KMOD_NONE};
+
+    Journal journal;
+    CHECK(journal_record_open(&journal, CHECK_FILE), "couldn't record: %s", SDL_GetError());
+    if (journal.data == NULL)
+        return;
+    const Uint32 start = journal.last_timestamp;
+    for (size_t i = 0; i < ARRAY_LEN(events); i++)
+    {
+        events[i].common.timestamp = start + 5 * (Uint32) i;
+        journal_record(&journal, &events[i], mods[i]);
+    }
+    CHECK(journal_record_close(&journal, CHECK_FILE), "couldn't record: %s", SDL_GetError());
+
+    CHECK(journal_replay_open(&journal, CHECK_FILE), "couldn't replay: %s", SDL_GetError());
+    SDL_Event event;
+    SDL_Keymod mod;
+    size_t replayed = 0;
+    while (journal_replay_next(&journal, &event, &mod))
+    {
+        if (replayed < ARRAY_LEN(events))
+        {
+            const SDL_Event *e = &events[replayed];
+            CHECK(event.type == e->type && mod == mods[replayed],
+                    "event %zu was replayed as another one", replayed);
+            if (event.type == SDL_MOUSEBUTTONDOWN)
+                CHECK(event.button.button == e->button.button
+                        && event.button.x == e->button.x && event.button.y == e->button.y,
+                        "the button press was replayed elsewhere");
+            else if (event.type == SDL_MOUSEMOTION)
+                CHECK(event.motion.x == 32767 && event.motion.y == e->motion.y,
+                        "the motion wasn't clamped to the record");
+            else if (event.type == SDL_MOUSEWHEEL)
+                CHECK(event.wheel.y == e->wheel.y, "the wheel was replayed as %d", event.wheel.y);
+            else if (event.type == SDL_KEYDOWN)
+                CHECK(event.key.keysym.sym == e->key.keysym.sym, "another key was replayed");
+        }
+        replayed++;
+    }
+    CHECK(replayed == ARRAY_LEN(events), "%zu events were replayed", replayed);
+    CHECK(journal.recorded_ms == 15, "the replay lasted %llu ms",
+            (unsigned long long) journal.recorded_ms);
+    journal_replay_close(&journal);
+    remove(CHECK_FILE);
+}
+
+int main(int argc, char *argv[])
+{
+    (void) argc;
+    (void) argv;
+    srand(CHECK_SEED);
+
+    check_evaluators();
+    check_forward_kernel("forward", bezier_forward, 1);
+    check_forward_kernel("forward/fixed", bezier_forward_fixed, 0);
+    check_chain();
+    check_drag(4, 0.001f, 0);
+    check_drag(256, 0.001f, 0);
+    /* Past the points the binomials of the weights fit in a double */
+    check_drag(1100, 0.01f, 0);
+    check_drag(3000, 0.01f, 0);
+    check_drag(3 * 40 + 1, 0.001f, 1);
+
+    check_arc_length(4, 0);
+    check_arc_length(200, 0);
+    /* A table of ARC_SEGMENT_SAMPLES for each of the segments */
+    check_arc_length(3 * 1000 + 1, 1);
+
+    check_closed();
+    check_lod(3 * 10 + 1);
+    check_lod(3 * 5000 + 1);
+
+    Pool *pool = pool_create(3);
+    CHECK(pool != NULL, "no memory for a pool");
+    if (pool != NULL)
+    {
+        check_scratch(pool, 7, 0);
+        check_scratch(pool, BERNSTEIN_MAX_POINTS + 88, 0);
+        check_scratch(pool, 3 * 1000 + 1, 1);
+        pool_destroy(pool);
+    }
+
+    check_scene_file();
+    check_text();
+    check_journal();
+
+    if (failures > 0)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
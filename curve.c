@@ -0,0 +1,915 @@
+/* Bezier curve with its control points, scratch and sample cache, see curve.h */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "curve.h"
+
+/* Smallest slice of the samples handed to a worker thread */
+#define SAMPLE_CHUNK_MIN 64
+/* Below this many point evaluations threads cost more than they save */
+#define SAMPLE_PARALLEL_MIN_WORK (64 * 1024)
+/* Up to this many points the unrolled de Casteljau kernels beat the
+ * SIMD batches too, see bezier_bench */
+#define SAMPLE_UNROLLED_SIMD_MAX_POINTS 4
+
+/* Samples of a curve with room for capacity points, enough for a few
+ * per segment of the longest chain */
+static size_t curve_samples_capacity(size_t capacity)
+{
+    return SAMPLES_CAPACITY + capacity;
+}
+
+/* Bytes of the arena holding every buffer of the curve */
+static size_t curve_arena_size(size_t capacity)
+{
+    const size_t samples = curve_samples_capacity(capacity) + 1;
+    return ARENA_BLOCK(capacity * sizeof(Vec2))
+        + 2 * ARENA_BLOCK(capacity * sizeof(float))
+        + ARENA_BLOCK(samples * sizeof(float))
+        + ARENA_BLOCK(samples * sizeof(Vec2));
+}
+
+/**
+ * Grows a buffer that only some modes need to at least size bytes,
+ * at least doubling it so it isn't grown again on the next edit
+ * @return 1 on success, 0 when out of memory, the buffer is unchanged then
+ */
+static int curve_grow(void **buffer, size_t *buffer_size, size_t size)
+{
+    if (size <= *buffer_size)
+        return 1;
+    if (size < *buffer_size * 2)
+        size = *buffer_size * 2;
+
+    void *grown = realloc(*buffer, size);
+    if (grown == NULL)
+        return 0;
+    *buffer = grown;
+    *buffer_size = size;
+    return 1;
+}
+
+/* Bytes of an arc length table entry, a point, its param and length */
+#define ARC_ENTRY_SIZE (sizeof(Vec2) + 2 * sizeof(float))
+
+/**
+ * Makes room for count + 1 entries in the arc length table. A chain
+ * needs ARC_SEGMENT_SAMPLES for every segment, more than all its points
+ * take up, so the table is only as big as the modes it was built in.
+ * @return 1 on success, 0 when out of memory, the table is unchanged then
+ */
+static int curve_arc_reserve(Curve *curve, size_t count)
+{
+    ArcLength *arc = &curve->arc;
+    if (count <= arc->capacity)
+        return 1;
+    if (!curve_grow(&arc->memory, &arc->size, (count + 1) * ARC_ENTRY_SIZE))
+        return 0;
+
+    const size_t entries = arc->size / ARC_ENTRY_SIZE;
+    arc->points = arc->memory;
+    arc->params = (float *) (arc->points + entries);
+    arc->lengths = arc->params + entries;
+    arc->capacity = entries - 1;
+    return 1;
+}
+
+/**
+ * Creates an empty curve
+ * @param path : BatchPath Instruction set the samples are evaluated with
+ * @param width, height, cell_size : float Grid for hit testing, see grid_create
+ * @return the curve or NULL when out of memory
+ */
+Curve *curve_create(BatchPath path, float width, float height, float cell_size)
+{
+    Curve *curve = calloc(1, sizeof(Curve));
+    if (curve == NULL)
+        return NULL;
+
+    curve->path = path;
+    curve->cache.dirty = 1;
+    curve->cache.weights_point = -1;
+    curve->arc.dirty = 1;
+    for (size_t level = 0; level < CURVE_LOD_LEVELS; level++)
+    {
+        curve->lods[level].dirty = 1;
+        curve->lods[level].weights_point = -1;
+    }
+
+    curve->grid = grid_create(width, height, cell_size, CURVE_INITIAL_CAPACITY);
+    curve->samples_grid = grid_create(width, height, cell_size, SAMPLES_CAPACITY + 1);
+    if (curve->grid == NULL || curve->samples_grid == NULL
+        || !curve_reserve(curve, CURVE_INITIAL_CAPACITY)
+        || !curve_arc_reserve(curve, ARC_LENGTH_SAMPLES))
+    {
+        curve_destroy(curve);
+        return NULL;
+    }
+    return curve;
+}
+
+void curve_destroy(Curve *curve)
+{
+    if (curve == NULL)
+        return;
+
+    grid_destroy(curve->grid);
+    grid_destroy(curve->samples_grid);
+    arena_free(&curve->arena);
+    free(curve->cache.weights);
+    free(curve->scratch);
+    free(curve->subdivision);
+    free(curve->arc.memory);
+    for (size_t level = 0; level < CURVE_LOD_LEVELS; level++)
+        free(curve->lod_memory[level]);
+    free(curve);
+}
+
+/**
+ * Makes room for at least capacity points, at least doubling the
+ * current capacity. Points and samples move over to the new arena.
+ * @return 1 on success, 0 when out of memory, the curve is unchanged then
+ */
+int curve_reserve(Curve *curve, size_t capacity)
+{
+    if (capacity <= curve->capacity)
+        return 1;
+    if (capacity < curve->capacity * 2)
+        capacity = curve->capacity * 2;
+
+    const size_t samples = curve_samples_capacity(capacity) + 1;
+    if (!grid_reserve(curve->grid, capacity))
+        return 0;
+
+    Arena arena;
+    if (!arena_init(&arena, curve_arena_size(capacity)))
+        return 0;
+
+    Vec2 *ps = arena_alloc(&arena, capacity * sizeof(Vec2));
+    curve->px = arena_alloc(&arena, capacity * sizeof(float));
+    curve->py = arena_alloc(&arena, capacity * sizeof(float));
+
+    SampleCache *cache = &curve->cache;
+    float *params = arena_alloc(&arena, samples * sizeof(float));
+    Vec2 *cached = arena_alloc(&arena, samples * sizeof(Vec2));
+
+    if (curve->count > 0)
+    {
+        memcpy(ps, curve->ps, curve->count * sizeof(Vec2));
+        memcpy(params, cache->params, (cache->count + 1) * sizeof(float));
+        memcpy(cached, cache->samples, (cache->count + 1) * sizeof(Vec2));
+    }
+
+    arena_free(&curve->arena);
+    curve->arena = arena;
+    curve->capacity = capacity;
+    curve->ps = ps;
+    cache->params = params;
+    cache->samples = cached;
+    cache->capacity = samples - 1;
+    cache->param_steps = 0;
+    return 1;
+}
+
+/**
+ * Appends a control point, growing the curve when it's full
+ * @return index of the point, -1 when out of memory
+ */
+int curve_push(Curve *curve, Vec2 pos)
+{
+    if (curve->count == curve->capacity && !curve_reserve(curve, curve->count + 1))
+        return -1;
+
+    grid_insert(curve->grid, curve->count, pos);
+    curve->ps[curve->count] = pos;
+    curve->bounds_dirty = 1;
+    curve_invalidate(curve);
+    return (int) curve->count++;
+}
+
+/**
+ * Appends count control points at once, growing the curve at most once
+ * @return 1 on success, 0 when out of memory, the curve is unchanged then
+ */
+int curve_append(Curve *curve, const Vec2 *points, size_t count)
+{
+    if (!curve_reserve(curve, curve->count + count))
+        return 0;
+
+    memcpy(curve->ps + curve->count, points, count * sizeof(Vec2));
+    curve_extend(curve, count);
+    return 1;
+}
+
+/**
+ * Takes in count points the caller wrote into reserved room right after
+ * the last point, see curve_reserve, so they don't have to be copied
+ */
+void curve_extend(Curve *curve, size_t count)
+{
+    grid_insert_range(curve->grid, curve->count, curve->ps + curve->count, count);
+    curve->count += count;
+    curve->bounds_dirty = 1;
+    curve_invalidate(curve);
+}
+
+void curve_invalidate(Curve *curve)
+{
+    curve->cache.dirty = 1;
+    curve->arc.dirty = 1;
+    for (size_t level = 0; level < CURVE_LOD_LEVELS; level++)
+        curve->lods[level].dirty = 1;
+}
+
+/* Versions are unique over all caches of a curve, so whatever
+ * remembers the version it drew also notices a switch of level */
+static void curve_changed(Curve *curve, SampleCache *cache)
+{
+    cache->version = ++curve->versions;
+}
+
+#ifdef BEZIER_FIXED_POINT
+#define curve_forward_kernel bezier_forward_fixed
+#else
+#define curve_forward_kernel bezier_forward
+#endif
+
+/**
+ * Forward differences the samples [begin, end) of the param grid
+ * i / steps, segment by segment
+ * @param steps : size_t Steps per segment, a single curve has at most 4 points
+ */
+static void curve_forward(const Curve *curve, size_t steps,
+        size_t begin, size_t end, Vec2 *out)
+{
+    const size_t n = curve->count;
+    const size_t segments = bezier_chain_segments(n);
+    size_t i = begin;
+    while (i < end)
+    {
+        size_t segment = i / steps;
+        if (segment >= segments)
+            segment = segments - 1;
+        size_t last = segment + 1 < segments ? (segment + 1) * steps : end;
+        if (last > end)
+            last = end;
+
+        const size_t left = n - segment * 3;
+        curve_forward_kernel(curve->ps + segment * 3, left < 4 ? left : 4,
+                steps, i - segment * steps, last - i, out + i);
+        i = last;
+    }
+}
+
+/**
+ * Moves control point k and the samples along with it instead of
+ * resampling. Every sample is linear in the control points, so it moves
+ * by the basis weight of k at its p times delta: O(samples) per motion
+ * instead of O(samples * n). The weights are computed when the drag
+ * starts and reused until another point is dragged or the params change.
+ * A chain of cubics only resamples the one or two segments sharing k.
+ * Caches that are out of date, adaptive or evenly spaced are just
+ * invalidated, the params of the last two depend on the shape.
+ * @param curve : Curve pointer
+ * @param k : size_t Index of the moved point
+ * @param pos : Vec2 New position of the point
+ */
+void curve_move(Curve *curve, size_t k, Vec2 pos)
+{
+    const Vec2 delta = vec2_sub(pos, curve->ps[k]);
+    const size_t n = curve->count;
+    curve->ps[k] = pos;
+    curve->bounds_dirty = 1;
+    grid_move(curve->grid, k, pos);
+    curve->arc.dirty = 1;
+    for (size_t level = 0; level < CURVE_LOD_LEVELS; level++)
+        curve->lods[level].dirty = 1;
+
+    SampleCache *cache = &curve->cache;
+    if (cache->dirty || cache->adaptive || cache->even)
+    {
+        curve_invalidate(curve);
+        return;
+    }
+
+    if (cache->piecewise)
+    {
+        /* The grid samples of the segments, the one at the start of
+         * the next segment is that segment's */
+        const size_t first = k > 0 ? (k - 1) / 3 : 0;
+        const size_t last = k / 3;
+        const size_t steps = cache->param_steps;
+        const size_t end = (last + 1) * steps < cache->count ? (last + 1) * steps : cache->count + 1;
+        curve_forward(curve, steps, first * steps, end, cache->samples);
+        curve_changed(curve, cache);
+        return;
+    }
+
+    /* Out of memory for the weights, resampled instead */
+    const size_t count = cache->count + 1;
+    if (!curve_grow((void **) &cache->weights, &curve->weights_size, count * sizeof(float)))
+    {
+        curve_invalidate(curve);
+        return;
+    }
+    if (cache->weights_point != (int) k)
+    {
+        bernstein_weights(n, k, cache->params, count, cache->weights);
+        cache->weights_point = (int) k;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        cache->samples[i].x += cache->weights[i] * delta.x;
+        cache->samples[i].y += cache->weights[i] * delta.y;
+    }
+    cache->drifted = 1;
+    curve_changed(curve, cache);
+}
+
+/**
+ * Ends a drag: rounding errors of the moves add up, so the samples are
+ * computed from scratch once more
+ * @return whether the curve has to be resampled
+ */
+int curve_settle(Curve *curve)
+{
+    if (!curve->cache.drifted)
+        return 0;
+
+    curve_invalidate(curve);
+    return 1;
+}
+
+/* Points of a curve to evaluate at params, split up by pool_parallel_for */
+typedef struct CurveEval
+{
+    Curve *curve;
+    int piecewise;
+    const float *params;
+    /* The params are i / steps, 0 if they are anything else */
+    size_t steps;
+    Vec2 *out;
+    /* Where the scratch of the workers comes from, the curve's own
+     * without a pool */
+    Pool *pool;
+} CurveEval;
+
+/* Evaluates params[begin, end) with the scratch of the worker */
+static void curve_sample_job(void *data, size_t begin, size_t end, size_t worker)
+{
+    const CurveEval *eval = data;
+    Curve *curve = eval->curve;
+    const size_t n = curve->count;
+    void *scratch = eval->pool != NULL ? pool_scratch(eval->pool, worker) : curve->scratch;
+
+    /* Cubics on the param grid are forward differenced, three adds
+     * per sample */
+    if ((eval->piecewise || n <= 4) && eval->steps > 0)
+    {
+        curve_forward(curve, eval->steps, begin, end, eval->out);
+        return;
+    }
+
+#ifdef BEZIER_FIXED_POINT
+    if (eval->piecewise)
+    {
+        for (size_t i = begin; i < end; i++)
+            eval->out[i] = bezier_chain_sample_fixed(curve->ps, n, eval->params[i]);
+        return;
+    }
+
+    Vec2Fixed *xs = scratch;
+    for (size_t i = begin; i < end; i++)
+        eval->out[i] = beziern_sample_fixed(curve->ps, xs, n, eval->params[i]);
+#else
+    if (eval->piecewise)
+    {
+        for (size_t i = begin; i < end; i++)
+            eval->out[i] = bezier_chain_sample(curve->ps, n, eval->params[i]);
+        return;
+    }
+
+    /* The unrolled low degree kernels win up to cubics, and up to
+     * BEZIER_UNROLLED_MAX_POINTS without SIMD lanes */
+    if (n <= (curve->path == BATCH_SCALAR
+            ? BEZIER_UNROLLED_MAX_POINTS
+            : SAMPLE_UNROLLED_SIMD_MAX_POINTS))
+    {
+        for (size_t i = begin; i < end; i++)
+            eval->out[i] = beziern_sample(curve->ps, NULL, n, eval->params[i]);
+        return;
+    }
+
+    /* Bernstein/Horner in O(n) up to BERNSTEIN_MAX_POINTS,
+     * de Casteljau in O(n^2) above that, both SIMD batched */
+    if (n <= BERNSTEIN_MAX_POINTS)
+    {
+        bernstein_sample_batch(curve->path, &curve->bernstein,
+                eval->params + begin, end - begin, eval->out + begin);
+    }
+    else
+    {
+        beziern_sample_batch(curve->path, curve->px, curve->py, n,
+                eval->params + begin, end - begin, eval->out + begin, scratch);
+    }
+#endif
+}
+
+/**
+ * Evaluates the curve at count params into out, split over the pool
+ * when there is enough work
+ * @param pool : Pool Worker threads, may be NULL
+ * @param piecewise : int Read the points as a chain of cubics
+ * @param steps : size_t The params are i / steps, 0 if they aren't
+ * @return 1 on success, 0 when out of memory for the scratch
+ */
+static int curve_evaluate(Curve *curve, Pool *pool, int piecewise,
+        const float *params, size_t steps, size_t count, Vec2 *out)
+{
+    const size_t n = curve->count;
+    size_t work = count * n;
+    /* Bytes every thread needs, only de Casteljau needs any */
+    size_t scratch = 0;
+    if (piecewise)
+    {
+        work = count * 4;
+    }
+#ifdef BEZIER_FIXED_POINT
+    else
+    {
+        work *= n / 2;
+        if (n > 4 || steps == 0)
+            scratch = n * sizeof(Vec2Fixed);
+    }
+#else
+    else if (n <= BERNSTEIN_MAX_POINTS)
+    {
+        bernstein_prepare(&curve->bernstein, curve->ps, n);
+    }
+    else
+    {
+        bezier_soa(curve->ps, n, curve->px, curve->py);
+        work *= n / 2;
+        scratch = BATCH_SCRATCH_FLOATS(n) * sizeof(float);
+    }
+#endif
+
+    /* Without scratch for every thread of the pool the loop runs
+     * inline, on the scratch of the curve */
+    if (scratch > 0 && pool != NULL && !pool_reserve_scratch(pool, scratch))
+        pool = NULL;
+    if (scratch > 0 && pool == NULL
+        && !curve_grow(&curve->scratch, &curve->scratch_size, scratch))
+        return 0;
+
+    /* A few chunks per thread so uneven threads even out,
+     * each a whole number of SIMD blocks */
+    size_t chunk = count;
+    if (work >= SAMPLE_PARALLEL_MIN_WORK)
+    {
+        chunk = count / (pool_threads(pool) * 4);
+        chunk = (chunk + BATCH_MAX_LANES - 1) / BATCH_MAX_LANES * BATCH_MAX_LANES;
+        if (chunk < SAMPLE_CHUNK_MIN)
+            chunk = SAMPLE_CHUNK_MIN;
+    }
+
+    CurveEval eval = {curve, piecewise, params, steps, out, pool};
+    pool_parallel_for(pool, count, chunk, curve_sample_job, &eval);
+    return 1;
+}
+
+/**
+ * Recursively halves piece until each part is flat within tolerance
+ * and appends the end of every flat part to the cache.
+ * The left halves at depth d live in subdivision[d * n], the right half
+ * keeps reusing the buffer of piece, so no slot is needed twice and
+ * (max_depth + 1) * n points are all it takes.
+ */
+static void curve_flatten(SampleCache *cache, Vec2 *subdivision, Vec2 *piece,
+        size_t n, size_t depth, size_t max_depth, float tolerance)
+{
+    while (depth < max_depth && !bezier_is_flat(piece, n, tolerance))
+    {
+        Vec2 *left = subdivision + (depth + 1) * n;
+        bezier_subdivide(piece, left, n);
+        depth++;
+        curve_flatten(cache, subdivision, left, n, depth, max_depth, tolerance);
+    }
+    cache->samples[++cache->count] = piece[n-1];
+}
+
+/* Out of memory for scratch: the cache only holds the first point
+ * until the next update tries again */
+static size_t curve_resample_failed(const Curve *curve, SampleCache *cache)
+{
+    cache->samples[0] = curve->ps[0];
+    cache->count = 0;
+    cache->dirty = 1;
+    return 0;
+}
+
+/* Resamples one cache of the curve, see curve_update_lod */
+static size_t curve_resample(Curve *curve, SampleCache *cache, Pool *pool, float s,
+        int piecewise, int even, int adaptive, float tolerance)
+{
+    const Vec2 *ps = curve->ps;
+    const size_t n = curve->count;
+
+    if (!cache->dirty && cache->piecewise == piecewise && cache->adaptive == adaptive
+        && (adaptive
+            ? cache->tolerance == tolerance
+            : cache->step == s && cache->even == even))
+        return 0;
+
+    cache->step = s;
+    cache->even = even;
+    cache->piecewise = piecewise;
+    cache->adaptive = adaptive;
+    cache->tolerance = tolerance;
+    cache->dirty = 0;
+    cache->drifted = 0;
+    cache->weights_point = -1;
+    curve_changed(curve, cache);
+
+    const size_t segments = piecewise ? bezier_chain_segments(n) : 1;
+    if (adaptive)
+    {
+        cache->samples[0] = ps[0];
+        cache->count = 0;
+        if (!piecewise)
+        {
+            if (!curve_grow((void **) &curve->subdivision, &curve->subdivision_size,
+                    (ADAPTIVE_MAX_DEPTH + 1) * n * sizeof(Vec2)))
+                return curve_resample_failed(curve, cache);
+
+            memcpy(curve->subdivision, ps, n * sizeof(Vec2));
+            curve_flatten(cache, curve->subdivision, curve->subdivision, n,
+                    0, ADAPTIVE_MAX_DEPTH, tolerance);
+            return cache->count + 1;
+        }
+
+        /* Shallower subdivision the more segments, so all fit */
+        size_t max_depth = 0;
+        while (max_depth < ADAPTIVE_MAX_DEPTH
+               && (segments << (max_depth + 1)) <= cache->capacity)
+            max_depth++;
+
+        Vec2 subdivision[(ADAPTIVE_MAX_DEPTH + 1) * 4];
+        for (size_t i = 0; i < segments; i++)
+        {
+            const size_t m = n - i * 3 < 4 ? n - i * 3 : 4;
+            memcpy(subdivision, ps + i * 3, m * sizeof(Vec2));
+            curve_flatten(cache, subdivision, subdivision, m,
+                    0, max_depth, tolerance);
+        }
+        return cache->count + 1;
+    }
+
+    /* Every segment gets the same whole number of steps, as close to s
+     * as they come, fewer if they don't fit */
+    size_t steps = (size_t) lroundf(1.0f / s);
+    if (steps < 1)
+        steps = 1;
+    if (steps * segments > cache->capacity)
+        steps = cache->capacity / segments;
+    cache->count = steps * segments;
+
+    /* p_i = i / steps from the index, so no rounding error adds up and
+     * both ends are sampled exactly. The grid only changes with the steps,
+     * moving points reuses it. */
+    if (cache->param_steps != steps || cache->param_count != cache->count)
+    {
+        for (size_t i = 0; i <= cache->count; i++)
+            cache->params[i] = (float) i / (float) steps;
+        cache->param_steps = steps;
+        cache->param_count = cache->count;
+    }
+
+    /* Same number of samples, at the same fractions of the length */
+    size_t evaluated = 0;
+    if (even)
+    {
+        evaluated = curve_arc_update(curve, pool, piecewise);
+        const float length = curve_arc_length(curve);
+        for (size_t i = 0; i <= cache->count; i++)
+            cache->params[i] = curve_arc_param(curve,
+                    length * (float) i / (float) cache->count);
+        cache->param_steps = 0;
+    }
+
+    const size_t count = cache->count + 1;
+    if (!curve_evaluate(curve, pool, piecewise, cache->params, cache->param_steps,
+            count, cache->samples))
+        return curve_resample_failed(curve, cache);
+    return evaluated + count;
+}
+
+/**
+ * Resamples the curve if the control points or the sampling settings
+ * changed since the last call, otherwise does nothing
+ * @param curve : Curve pointer, must have at least one point
+ * @param pool : Pool Worker threads sharing the uniform sampling, may be NULL
+ * @param s : float Sample step of the uniform mode
+ * @param piecewise : int Read the points as a chain of cubics instead of one curve
+ * @param even : int Space the uniform samples evenly by arc length instead of param
+ * @param adaptive : int Use flatness based subdivision instead of s
+ * @param tolerance : float Flatness tolerance in logical units
+ * @return number of points evaluated, 0 if the cache was up to date
+ */
+size_t curve_update(Curve *curve, Pool *pool, float s,
+        int piecewise, int even, int adaptive, float tolerance)
+{
+    return curve_resample(curve, &curve->cache, pool, s,
+            piecewise, even, adaptive, tolerance);
+}
+
+/* Bytes of a level of detail sample, the point and its param */
+#define LOD_ENTRY_SIZE (sizeof(Vec2) + sizeof(float))
+
+/**
+ * Makes room for count + 1 samples in a level of detail. A level only
+ * takes memory once a curve is drawn at it, and only as much as its
+ * steps need for the points of the curve.
+ * @return 1 on success, 0 when out of memory, the level is unchanged then
+ */
+static int curve_lod_reserve(Curve *curve, int level, size_t count)
+{
+    SampleCache *lod = &curve->lods[level];
+    if (count <= lod->capacity)
+        return 1;
+    if (!curve_grow(&curve->lod_memory[level], &curve->lod_sizes[level],
+            (count + 1) * LOD_ENTRY_SIZE))
+        return 0;
+
+    const size_t entries = curve->lod_sizes[level] / LOD_ENTRY_SIZE;
+    lod->samples = curve->lod_memory[level];
+    lod->params = (float *) (lod->samples + entries);
+    lod->capacity = entries - 1;
+    lod->param_steps = 0;
+    lod->dirty = 1;
+    /* Nothing is drawn from the moved samples before they are resampled */
+    lod->samples[0] = curve->ps[0];
+    lod->count = 0;
+    return 1;
+}
+
+/**
+ * Level of detail of the uniform samples for a curve scale times its
+ * size on screen: the first level with at least one step per
+ * LOD_PIXELS_PER_STEP of the longer side of its box. Zooming doesn't
+ * change the level until the size doubles or halves. The first time a
+ * level is picked its samples are allocated, out of memory the curve
+ * stays at the full density.
+ * @param curve : Curve pointer, must have at least one point
+ * @param s : float Sample step of the full density
+ * @param scale : float Screen pixels per unit of the curve
+ * @return the level, -1 for the full density of s
+ */
+int curve_lod_level(Curve *curve, float s, int piecewise, int adaptive, float scale)
+{
+    if (adaptive)
+        return -1;
+
+    Vec2 min, max;
+    curve_bounds(curve, &min, &max);
+    const float size = fmaxf(max.x - min.x, max.y - min.y) * scale;
+    const size_t segments = piecewise ? bezier_chain_segments(curve->count) : 1;
+    const float wanted = size / LOD_PIXELS_PER_STEP / (float) segments;
+    const size_t full = (size_t) lroundf(1.0f / s);
+
+    for (int level = 0; level < CURVE_LOD_LEVELS; level++)
+    {
+        const size_t steps = (size_t) LOD_BASE_STEPS << level;
+        if (steps >= full)
+            return -1;
+        if ((float) steps >= wanted)
+            return curve_lod_reserve(curve, level, steps * segments) ? level : -1;
+    }
+    return -1;
+}
+
+/* Samples of a level of detail, -1 for the full density cache */
+SampleCache *curve_lod_cache(Curve *curve, int level)
+{
+    return level < 0 ? &curve->cache : &curve->lods[level];
+}
+
+/**
+ * curve_update for a level of detail, every level keeps its samples
+ * until the points change, so switching between levels is free
+ * @param level : int See curve_lod_level, -1 is curve_update
+ * @return number of points evaluated, 0 if the cache was up to date
+ */
+size_t curve_update_lod(Curve *curve, Pool *pool, int level, float s,
+        int piecewise, int even, int adaptive, float tolerance)
+{
+    if (level < 0)
+        return curve_update(curve, pool, s, piecewise, even, adaptive, tolerance);
+
+    return curve_resample(curve, &curve->lods[level], pool,
+            1.0f / (float) (LOD_BASE_STEPS << level), piecewise, even, 0, tolerance);
+}
+
+/**
+ * Rebuilds the arc length table if the points or the mode changed since
+ * it was last built, the param space is the one of curve_update
+ * @param curve : Curve pointer, must have at least one point
+ * @param pool : Pool Worker threads sharing the evaluation, may be NULL
+ * @param piecewise : int Read the points as a chain of cubics
+ * @return number of points evaluated, 0 if the table was up to date
+ */
+size_t curve_arc_update(Curve *curve, Pool *pool, int piecewise)
+{
+    ArcLength *arc = &curve->arc;
+    if (!arc->dirty && arc->piecewise == piecewise)
+        return 0;
+
+    const size_t segments = piecewise ? bezier_chain_segments(curve->count) : 1;
+    /* Out of memory, a coarser table than asked for */
+    size_t count = piecewise ? segments * ARC_SEGMENT_SAMPLES : ARC_LENGTH_SAMPLES;
+    if (!curve_arc_reserve(curve, count))
+        count = arc->capacity;
+
+    /* Computed from the index, so the last param is exactly the end */
+    for (size_t i = 0; i <= count; i++)
+        arc->params[i] = (float) segments * (float) i / (float) count;
+    if (!curve_evaluate(curve, pool, piecewise, arc->params,
+            count % segments == 0 ? count / segments : 0, count + 1, arc->points))
+    {
+        /* Out of memory, a table of the first point until the next try */
+        arc->points[0] = curve->ps[0];
+        arc->lengths[0] = 0.0f;
+        arc->count = 0;
+        return 0;
+    }
+
+    arc->lengths[0] = 0.0f;
+    for (size_t i = 1; i <= count; i++)
+    {
+        const Vec2 d = vec2_sub(arc->points[i], arc->points[i-1]);
+        arc->lengths[i] = arc->lengths[i-1] + hypotf(d.x, d.y);
+    }
+
+    arc->count = count;
+    arc->piecewise = piecewise;
+    arc->dirty = 0;
+    return count + 1;
+}
+
+/* Length of the curve, curve_arc_update must be called after an edit */
+float curve_arc_length(const Curve *curve)
+{
+    return curve->arc.lengths[curve->arc.count];
+}
+
+/**
+ * Binary search for the entries of the arc length table around length
+ * @param t : float Where length lies between lo and lo + 1, in [0, 1]
+ * @return lo, the entry at or before length
+ */
+static size_t curve_arc_find(const ArcLength *arc, float length, float *t)
+{
+    *t = 0.0f;
+    if (length <= 0.0f)
+        return 0;
+    if (length >= arc->lengths[arc->count])
+        return arc->count;
+
+    /* lengths[lo] < length <= lengths[hi] */
+    size_t lo = 0;
+    size_t hi = arc->count;
+    while (hi - lo > 1)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (arc->lengths[mid] < length)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    const float span = arc->lengths[hi] - arc->lengths[lo];
+    if (span > 0.0f)
+        *t = (length - arc->lengths[lo]) / span;
+    return lo;
+}
+
+/**
+ * Inverts the arc length table, linear interpolation between the params
+ * of the entries around length. O(log n) in the table size.
+ * curve_arc_update must be called after an edit.
+ * @param length : float Distance from the start along the curve,
+ * clamped to [0, curve_arc_length]
+ * @return param at that distance, in the param space of curve_update
+ */
+float curve_arc_param(const Curve *curve, float length)
+{
+    const ArcLength *arc = &curve->arc;
+    float t;
+    const size_t lo = curve_arc_find(arc, length, &t);
+    if (lo == arc->count)
+        return arc->params[lo];
+    return lerpf(arc->params[lo], arc->params[lo+1], t);
+}
+
+/**
+ * Point at a distance along the curve, read from the arc length table
+ * without evaluating the curve, see curve_arc_param
+ */
+Vec2 curve_arc_point(const Curve *curve, float length)
+{
+    const ArcLength *arc = &curve->arc;
+    float t;
+    const size_t lo = curve_arc_find(arc, length, &t);
+    if (lo == arc->count)
+        return arc->points[lo];
+    return lerpv2(arc->points[lo], arc->points[lo+1], t);
+}
+
+/**
+ * Box around the control points. A Bezier curve never leaves the convex
+ * hull of its points, so it also bounds every sample in [0, 1].
+ * Recomputed only after points were added or moved.
+ * @param curve : Curve pointer, must have at least one point
+ * @param min, max : Vec2 Corners of the box
+ */
+void curve_bounds(Curve *curve, Vec2 *min, Vec2 *max)
+{
+    if (curve->bounds_dirty)
+    {
+        curve->bounds_min = curve->ps[0];
+        curve->bounds_max = curve->ps[0];
+        for (size_t i = 1; i < curve->count; i++)
+        {
+            curve->bounds_min.x = fminf(curve->bounds_min.x, curve->ps[i].x);
+            curve->bounds_min.y = fminf(curve->bounds_min.y, curve->ps[i].y);
+            curve->bounds_max.x = fmaxf(curve->bounds_max.x, curve->ps[i].x);
+            curve->bounds_max.y = fmaxf(curve->bounds_max.y, curve->ps[i].y);
+        }
+        curve->bounds_dirty = 0;
+    }
+    *min = curve->bounds_min;
+    *max = curve->bounds_max;
+}
+
+/* Whether the bounds of the curve overlap the box, empty curves never do */
+int curve_intersects(Curve *curve, Vec2 min, Vec2 max)
+{
+    if (curve->count == 0)
+        return 0;
+
+    Vec2 bounds_min, bounds_max;
+    curve_bounds(curve, &bounds_min, &bounds_max);
+    return bounds_min.x <= max.x && bounds_max.x >= min.x
+        && bounds_min.y <= max.y && bounds_max.y >= min.y;
+}
+
+/**
+ * Take a position and check if there is a control point there
+ * @param pos : Vec2
+ * @param half_size : float Half the side of the hit box around every point
+ * @return index of the point, -1 if none
+ */
+int curve_point_at(const Curve *curve, Vec2 pos, float half_size)
+{
+    return grid_hit(curve->grid, curve->ps, pos, half_size);
+}
+
+/**
+ * Whether the curve ends where it starts: it has at least 3 points and
+ * the last one is within the hit box of the first
+ * @param half_size : float Half the side of the hit box, see curve_point_at
+ */
+int curve_closed(const Curve *curve, float half_size)
+{
+    if (curve->count < 3)
+        return 0;
+
+    const Vec2 first = curve->ps[0];
+    const Vec2 last = curve->ps[curve->count - 1];
+    return fabsf(last.x - first.x) <= half_size && fabsf(last.y - first.y) <= half_size;
+}
+
+/**
+ * Take a position and check if there is a curve sample there
+ * @param pos : Vec2
+ * @param half_size : float Half the side of the hit box around every sample
+ * @return index of the sample in the cache, -1 if none or out of memory
+ */
+int curve_sample_at(Curve *curve, Vec2 pos, float half_size)
+{
+    const SampleCache *cache = &curve->cache;
+    if (curve->samples_grid_version != cache->version)
+    {
+        /* Sized by the samples there are, not the ones there could be */
+        if (!grid_reserve(curve->samples_grid, cache->count + 1))
+            return -1;
+        grid_clear(curve->samples_grid);
+        for (size_t i = 0; i <= cache->count; i++)
+            grid_insert(curve->samples_grid, i, cache->samples[i]);
+        curve->samples_grid_version = cache->version;
+    }
+    return grid_hit(curve->samples_grid, cache->samples, pos, half_size);
+}
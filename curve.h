@@ -0,0 +1,178 @@
+/* Bezier curve with its control points, scratch and sample cache
+ *
+ * Every buffer a curve always needs lives in one arena, sized for the
+ * point capacity. Adding a point past the capacity doubles it and moves
+ * everything into a new arena, so there is no allocation per frame and
+ * no global state: any number of curves can exist side by side.
+ * Scratch only some modes need is allocated the first time it is
+ * needed, and kept, and the scratch of threads belongs to the pool.
+ */
+
+#ifndef CURVE_H_
+#define CURVE_H_
+
+#include "arena.h"
+#include "bezier.h"
+#include "grid.h"
+#include "pool.h"
+
+/* Samples always available, curves with many points get more */
+#define SAMPLES_CAPACITY 1024
+/* 2^ADAPTIVE_MAX_DEPTH segments always fit in SAMPLES_CAPACITY */
+#define ADAPTIVE_MAX_DEPTH 10
+/* Points a new curve has room for */
+#define CURVE_INITIAL_CAPACITY 64
+/* Arc length table entries of one curve, and of every cubic of a chain */
+#define ARC_LENGTH_SAMPLES 256
+#define ARC_SEGMENT_SAMPLES 32
+/* Coarse sample caches of curves small on screen, level l has
+ * LOD_BASE_STEPS << l steps per segment, see curve_lod_level */
+#define CURVE_LOD_LEVELS 5
+#define LOD_BASE_STEPS 2
+/* Screen pixels of the longer side of the box one step is aimed at */
+#define LOD_PIXELS_PER_STEP 4.0f
+
+/**
+ * Polyline of curve samples shared by the curve and marker renderers.
+ * Filled once per (control points, step) pair and reused every frame
+ * until a point moves or the step changes.
+ *
+ * samples[0..count] are both the marker positions and the polyline,
+ * from the start to the end of the curve. With uniform sampling they are
+ * the points at p_i = i / N for the whole number of steps N closest to
+ * 1 / s, so only the step decides how many there are. With adaptive
+ * sampling every sample after the first ends one flat segment.
+ *
+ * In piecewise mode the points are a chain of cubics, see
+ * bezier_chain_sample, and the params run over [0, segments] with N
+ * steps in every segment.
+ *
+ * While a point is dragged the uniform samples are moved incrementally
+ * with the basis weights of that point, see curve_move.
+ *
+ * In even mode the uniform params are mapped through the arc length
+ * table, so the samples are as many as with the step but equally far
+ * apart along the curve.
+ */
+typedef struct SampleCache
+{
+    float *params;
+    Vec2 *samples;
+    /* Basis weights of control point weights_point at every param */
+    float *weights;
+    size_t capacity;
+    /* The uniform params are i / param_steps for i in [0, param_count],
+     * 0 steps when they hold anything else */
+    size_t param_steps;
+    size_t param_count;
+
+    size_t count;
+    float step;
+    int even;
+    int adaptive;
+    float tolerance;
+    int piecewise;
+    int dirty;
+    /* Bumped whenever the samples change */
+    unsigned version;
+
+    int weights_point;
+    /* The samples were moved since they were last computed from scratch */
+    int drifted;
+} SampleCache;
+
+/**
+ * Cumulative length of the polyline through the curve at count + 1
+ * uniformly spaced params, lengths[0] is 0. Fine enough that linear
+ * interpolation between the entries inverts it, see curve_arc_param.
+ * Rebuilt by curve_arc_update the first time it is needed after an edit.
+ */
+typedef struct ArcLength
+{
+    /* One allocation holding all three, see curve_arc_reserve */
+    void *memory;
+    size_t size;
+    Vec2 *points;
+    float *params;
+    float *lengths;
+    size_t capacity;
+
+    size_t count;
+    int piecewise;
+    int dirty;
+} ArcLength;
+
+typedef struct Curve
+{
+    Arena arena;
+    size_t capacity;
+
+    Vec2 *ps;
+    size_t count;
+
+    /* Box around the control points, which contains the whole curve */
+    Vec2 bounds_min;
+    Vec2 bounds_max;
+    int bounds_dirty;
+
+    /* Evaluation scratch, the one of threads comes from the pool */
+    BatchPath path;
+    Bernstein bernstein;
+    float *px;
+    float *py;
+    /* de Casteljau scratch of evaluations without a pool and the halves
+     * of the adaptive subdivision of single curves, sizes in bytes */
+    void *scratch;
+    size_t scratch_size;
+    Vec2 *subdivision;
+    size_t subdivision_size;
+
+    SampleCache cache;
+    /* Bytes of cache.weights, allocated by the first drag of a point */
+    size_t weights_size;
+    ArcLength arc;
+    /* Uniform samples only, never moved incrementally, allocated when
+     * the curve is first drawn at the level, see curve_lod_level */
+    SampleCache lods[CURVE_LOD_LEVELS];
+    void *lod_memory[CURVE_LOD_LEVELS];
+    size_t lod_sizes[CURVE_LOD_LEVELS];
+    /* Last version handed to any cache */
+    unsigned versions;
+
+    Grid *grid;
+    Grid *samples_grid;
+    unsigned samples_grid_version;
+} Curve;
+
+Curve *curve_create(BatchPath path, float width, float height, float cell_size);
+void curve_destroy(Curve *curve);
+int curve_reserve(Curve *curve, size_t capacity);
+
+int curve_push(Curve *curve, Vec2 pos);
+int curve_append(Curve *curve, const Vec2 *points, size_t count);
+void curve_extend(Curve *curve, size_t count);
+void curve_move(Curve *curve, size_t k, Vec2 pos);
+int curve_settle(Curve *curve);
+void curve_invalidate(Curve *curve);
+
+size_t curve_update(Curve *curve, Pool *pool, float s,
+        int piecewise, int even, int adaptive, float tolerance);
+
+int curve_lod_level(Curve *curve, float s, int piecewise, int adaptive, float scale);
+SampleCache *curve_lod_cache(Curve *curve, int level);
+size_t curve_update_lod(Curve *curve, Pool *pool, int level, float s,
+        int piecewise, int even, int adaptive, float tolerance);
+
+size_t curve_arc_update(Curve *curve, Pool *pool, int piecewise);
+float curve_arc_length(const Curve *curve);
+float curve_arc_param(const Curve *curve, float length);
+Vec2 curve_arc_point(const Curve *curve, float length);
+
+void curve_bounds(Curve *curve, Vec2 *min, Vec2 *max);
+int curve_intersects(Curve *curve, Vec2 min, Vec2 max);
+
+int curve_point_at(const Curve *curve, Vec2 pos, float half_size);
+int curve_closed(const Curve *curve, float half_size);
+int curve_sample_at(Curve *curve, Vec2 pos, float half_size);
+
+#endif // CURVE_H_
@@ -0,0 +1,338 @@
+/* Filled regions of closed polylines, see fill.h */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fill.h"
+
+/**
+ * Creates the streaming texture the shapes are rasterized into
+ * @param width, height : int Size of the texture, the logical size
+ * @return 0 on success, a negative SDL error code otherwise
+ */
+int fill_init(Fill *fill, SDL_Renderer *renderer, int width, int height)
+{
+    memset(fill, 0, sizeof(Fill));
+    fill->zoom = 1.0f;
+    fill->width = width;
+    fill->height = height;
+
+    fill->pixels = calloc((size_t) width * height, 4);
+    fill->coverage = calloc((size_t) width, sizeof(float));
+    if (fill->pixels == NULL || fill->coverage == NULL)
+    {
+        fill_free(fill);
+        return SDL_OutOfMemory();
+    }
+
+    fill->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+            SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (fill->texture == NULL
+        || SDL_SetTextureBlendMode(fill->texture, SDL_BLENDMODE_BLEND) < 0)
+    {
+        fill_free(fill);
+        return -1;
+    }
+    return 0;
+}
+
+void fill_free(Fill *fill)
+{
+    if (fill->texture != NULL)
+        SDL_DestroyTexture(fill->texture);
+    free(fill->pixels);
+    free(fill->coverage);
+    free(fill->edges);
+    free(fill->active);
+    free(fill->shapes);
+    free(fill->drawn);
+    memset(fill, 0, sizeof(Fill));
+}
+
+/**
+ * Starts recording the shapes of a frame
+ * @param offset, zoom : Vec2, float The points are drawn at (p - offset) * zoom
+ */
+void fill_begin(Fill *fill, Vec2 offset, float zoom)
+{
+    fill->shapes_count = 0;
+    fill->changed = offset.x != fill->offset.x || offset.y != fill->offset.y
+        || zoom != fill->zoom;
+    fill->failed = 0;
+    fill->offset = offset;
+    fill->zoom = zoom;
+}
+
+static int fill_same_shape(const FillShape *a, const FillShape *b)
+{
+    return a->points == b->points && a->count == b->count
+        && a->version == b->version
+        && a->color.r == b->color.r && a->color.g == b->color.g
+        && a->color.b == b->color.b && a->color.a == b->color.a;
+}
+
+/**
+ * Adds a shape to the frame, drawn over the shapes added before it.
+ * The points must stay untouched until fill_end.
+ * @param version : unsigned Changes whenever the points do
+ */
+void fill_shape(Fill *fill, const Vec2 *points, size_t count,
+        unsigned version, SDL_Color color)
+{
+    if (fill->failed)
+        return;
+
+    if (fill->shapes_count == fill->shapes_capacity)
+    {
+        const size_t capacity = fill->shapes_capacity > 0 ? fill->shapes_capacity * 2 : 16;
+        FillShape *shapes = realloc(fill->shapes, capacity * sizeof(FillShape));
+        if (shapes != NULL)
+            fill->shapes = shapes;
+        FillShape *drawn = realloc(fill->drawn, capacity * sizeof(FillShape));
+        if (drawn != NULL)
+            fill->drawn = drawn;
+        if (shapes == NULL || drawn == NULL)
+        {
+            fill->failed = 1;
+            return;
+        }
+        fill->shapes_capacity = capacity;
+    }
+
+    const FillShape shape = {points, count, version, color};
+    const size_t i = fill->shapes_count++;
+    fill->shapes[i] = shape;
+    if (i >= fill->drawn_count || !fill_same_shape(&fill->drawn[i], &shape))
+        fill->changed = 1;
+}
+
+static int fill_compare_edges(const void *a, const void *b)
+{
+    const float y0 = ((const FillEdge *) a)->y0;
+    const float y1 = ((const FillEdge *) b)->y0;
+    return (y0 > y1) - (y0 < y1);
+}
+
+/* Edge table of a shape on screen, sorted by the top end of the edges */
+static size_t fill_build_edges(Fill *fill, const FillShape *shape)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < shape->count; i++)
+    {
+        Vec2 a = shape->points[i];
+        Vec2 b = shape->points[i + 1 < shape->count ? i + 1 : 0];
+        a = vec2_scale(vec2_sub(a, fill->offset), fill->zoom);
+        b = vec2_scale(vec2_sub(b, fill->offset), fill->zoom);
+        if (a.y == b.y)
+            continue;
+
+        int winding = 1;
+        if (a.y > b.y)
+        {
+            const Vec2 t = a;
+            a = b;
+            b = t;
+            winding = -1;
+        }
+
+        FillEdge *edge = &fill->edges[count++];
+        edge->y0 = a.y;
+        edge->y1 = b.y;
+        edge->x0 = a.x;
+        edge->dxdy = (b.x - a.x) / (b.y - a.y);
+        edge->winding = winding;
+    }
+    qsort(fill->edges, count, sizeof(FillEdge), fill_compare_edges);
+    return count;
+}
+
+/**
+ * Adds weight times the part of [x0, x1) inside every pixel to the
+ * coverage row. The inner pixels are fully covered, the loop over them
+ * is a plain add the compiler vectorizes.
+ */
+static void fill_span(float *coverage, int width, float x0, float x1, float weight,
+        int *min, int *max)
+{
+    x0 = fmaxf(x0, 0.0f);
+    x1 = fminf(x1, (float) width);
+    if (x0 >= x1)
+        return;
+
+    const int i0 = (int) x0;
+    const int i1 = (int) x1;
+    if (i0 < *min)
+        *min = i0;
+    if (i1 > *max)
+        *max = i1 < width ? i1 : width - 1;
+
+    if (i0 == i1)
+    {
+        coverage[i0] += (x1 - x0) * weight;
+        return;
+    }
+
+    coverage[i0] += ((float) (i0 + 1) - x0) * weight;
+    for (int i = i0 + 1; i < i1; i++)
+        coverage[i] += weight;
+    if (i1 < width)
+        coverage[i1] += (x1 - (float) i1) * weight;
+}
+
+/* Blends the coverage of row y in color over the pixels and clears it */
+static void fill_composite(Fill *fill, int y, int min, int max, SDL_Color color)
+{
+    Uint8 *pixel = fill->pixels + ((size_t) y * fill->width + min) * 4;
+    const float alpha = color.a / 255.0f;
+    for (int x = min; x <= max; x++, pixel += 4)
+    {
+        const float coverage = fill->coverage[x];
+        fill->coverage[x] = 0.0f;
+        if (coverage <= 0.0f)
+            continue;
+
+        /* Source over with straight alpha, as SDL_BLENDMODE_BLEND expects */
+        const float sa = fminf(coverage, 1.0f) * alpha;
+        const float da = pixel[3] / 255.0f * (1.0f - sa);
+        const float a = sa + da;
+        if (a <= 0.0f)
+            continue;
+        pixel[0] = (Uint8) ((color.r * sa + pixel[0] * da) / a + 0.5f);
+        pixel[1] = (Uint8) ((color.g * sa + pixel[1] * da) / a + 0.5f);
+        pixel[2] = (Uint8) ((color.b * sa + pixel[2] * da) / a + 0.5f);
+        pixel[3] = (Uint8) (a * 255.0f + 0.5f);
+    }
+}
+
+/**
+ * Active edge scanline fill of one shape. The scanlines go through the
+ * middle of FILL_SUBSAMPLES horizontal bands of every row. Edges enter
+ * the active list in the order of the edge table and leave it below
+ * their bottom end, the list is kept sorted by x with an insertion
+ * sort, which is linear while the crossings barely move.
+ */
+static void fill_rasterize(Fill *fill, const FillShape *shape)
+{
+    const size_t count = fill_build_edges(fill, shape);
+    if (count == 0)
+        return;
+
+    float bottom = fill->edges[0].y1;
+    for (size_t i = 1; i < count; i++)
+        bottom = fmaxf(bottom, fill->edges[i].y1);
+
+    const int first = (int) fmaxf(floorf(fill->edges[0].y0), 0.0f);
+    const int last = (int) fminf(ceilf(bottom), (float) fill->height);
+    const float weight = 1.0f / FILL_SUBSAMPLES;
+
+    FillEdge **active = fill->active;
+    size_t active_count = 0;
+    size_t next = 0;
+    for (int y = first; y < last; y++)
+    {
+        int min = fill->width;
+        int max = -1;
+        for (int s = 0; s < FILL_SUBSAMPLES; s++)
+        {
+            const float scanline = (float) y + ((float) s + 0.5f) * weight;
+
+            size_t kept = 0;
+            for (size_t i = 0; i < active_count; i++)
+            {
+                if (active[i]->y1 > scanline)
+                    active[kept++] = active[i];
+            }
+            active_count = kept;
+            for (; next < count && fill->edges[next].y0 <= scanline; next++)
+            {
+                if (fill->edges[next].y1 > scanline)
+                    active[active_count++] = &fill->edges[next];
+            }
+
+            for (size_t i = 0; i < active_count; i++)
+            {
+                FillEdge *edge = active[i];
+                edge->x = edge->x0 + (scanline - edge->y0) * edge->dxdy;
+
+                size_t j = i;
+                for (; j > 0 && active[j-1]->x > edge->x; j--)
+                    active[j] = active[j-1];
+                active[j] = edge;
+            }
+
+            /* Non-zero rule: inside wherever the winding isn't 0 */
+            int winding = 0;
+            float start = 0.0f;
+            for (size_t i = 0; i < active_count; i++)
+            {
+                const int before = winding;
+                winding += active[i]->winding;
+                if (before == 0 && winding != 0)
+                    start = active[i]->x;
+                else if (before != 0 && winding == 0)
+                    fill_span(fill->coverage, fill->width, start, active[i]->x, weight, &min, &max);
+            }
+        }
+
+        if (max >= min)
+            fill_composite(fill, y, min, max, shape->color);
+    }
+}
+
+/* Makes room for the edges of the largest shape */
+static int fill_reserve_edges(Fill *fill)
+{
+    size_t needed = 0;
+    for (size_t i = 0; i < fill->shapes_count; i++)
+    {
+        if (fill->shapes[i].count > needed)
+            needed = fill->shapes[i].count;
+    }
+    if (needed <= fill->edges_capacity)
+        return 1;
+
+    FillEdge *edges = realloc(fill->edges, needed * sizeof(FillEdge));
+    if (edges == NULL)
+        return 0;
+    fill->edges = edges;
+
+    FillEdge **active = realloc(fill->active, needed * sizeof(FillEdge *));
+    if (active == NULL)
+        return 0;
+    fill->active = active;
+
+    fill->edges_capacity = needed;
+    return 1;
+}
+
+/**
+ * Ends the frame: if any shape differs from the last rasterization, all
+ * of them are rasterized again and the texture is uploaded once
+ * @return 0 on success, a negative SDL error code otherwise
+ */
+int fill_end(Fill *fill)
+{
+    if (fill->failed)
+        return SDL_OutOfMemory();
+    if (!fill->changed && fill->shapes_count == fill->drawn_count)
+        return 0;
+    if (!fill_reserve_edges(fill))
+        return SDL_OutOfMemory();
+
+    memset(fill->pixels, 0, (size_t) fill->width * fill->height * 4);
+    for (size_t i = 0; i < fill->shapes_count; i++)
+        fill_rasterize(fill, &fill->shapes[i]);
+
+    memcpy(fill->drawn, fill->shapes, fill->shapes_count * sizeof(FillShape));
+    fill->drawn_count = fill->shapes_count;
+    return SDL_UpdateTexture(fill->texture, NULL, fill->pixels, fill->width * 4);
+}
+
+/* Draws the filled shapes over the whole logical viewport */
+int fill_draw(const Fill *fill, SDL_Renderer *renderer)
+{
+    if (fill->drawn_count == 0)
+        return 0;
+    return SDL_RenderCopy(renderer, fill->texture, NULL, NULL);
+}
@@ -0,0 +1,79 @@
+/* Filled regions of closed polylines
+ *
+ * The shapes are rasterized on the CPU with an active edge scanline
+ * algorithm: every pixel row is crossed by FILL_SUBSAMPLES scanlines,
+ * and span ends are accumulated with their exact horizontal coverage,
+ * which anti-aliases the edges. The result goes into one streaming
+ * texture that is only uploaded again when a shape changed, drawing it
+ * is a single SDL_RenderCopy.
+ *
+ * Shapes are filled with the non-zero rule, an open polyline is closed
+ * by a line from its last point back to the first.
+ */
+
+#ifndef FILL_H_
+#define FILL_H_
+
+#include "SDL.h"
+
+#include "bezier.h"
+
+/* Scanlines per pixel row */
+#define FILL_SUBSAMPLES 4
+
+/* Non-horizontal segment of a shape, from its top to its bottom end */
+typedef struct FillEdge
+{
+    float y0;
+    float y1;
+    float x0;
+    float dxdy;
+    int winding;
+    /* Where the edge crosses the current scanline */
+    float x;
+} FillEdge;
+
+/* What a shape was rasterized from, to notice changes */
+typedef struct FillShape
+{
+    const Vec2 *points;
+    size_t count;
+    unsigned version;
+    SDL_Color color;
+} FillShape;
+
+typedef struct Fill
+{
+    SDL_Texture *texture;
+    int width;
+    int height;
+    Uint8 *pixels;
+    float *coverage;
+
+    FillEdge *edges;
+    FillEdge **active;
+    size_t edges_capacity;
+
+    /* Shapes of the frame being recorded and of the last rasterization */
+    FillShape *shapes;
+    FillShape *drawn;
+    size_t shapes_count;
+    size_t drawn_count;
+    size_t shapes_capacity;
+    /* View of the frame being recorded, see fill_begin */
+    Vec2 offset;
+    float zoom;
+    int changed;
+    int failed;
+} Fill;
+
+int fill_init(Fill *fill, SDL_Renderer *renderer, int width, int height);
+void fill_free(Fill *fill);
+
+void fill_begin(Fill *fill, Vec2 offset, float zoom);
+void fill_shape(Fill *fill, const Vec2 *points, size_t count,
+        unsigned version, SDL_Color color);
+int fill_end(Fill *fill);
+int fill_draw(const Fill *fill, SDL_Renderer *renderer);
+
+#endif // FILL_H_
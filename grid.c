@@ -0,0 +1,225 @@
+/* Uniform grid for hit testing points, see grid.h */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "grid.h"
+
+/* Cell coordinates are clamped to this, far beyond any real scene, so
+ * the conversion of far away points can't overflow int */
+#define GRID_MAX_CELL (1 << 30)
+
+/* Every bucket is a doubly linked list threaded through next/prev,
+ * so moving a point between buckets is O(1) */
+struct Grid
+{
+    float cell_size;
+    size_t buckets;
+    int *heads;
+
+    size_t capacity;
+    int *next;
+    int *prev;
+    int *cells; /* cell of every index, -1 when not in the grid */
+};
+
+static int grid_coordinate(const Grid *grid, float v)
+{
+    const float cell = floorf(v / grid->cell_size);
+    if (!(cell > (float) -GRID_MAX_CELL))
+        return -GRID_MAX_CELL;
+    return cell < (float) GRID_MAX_CELL ? (int) cell : GRID_MAX_CELL;
+}
+
+static int grid_bucket(const Grid *grid, int col, int row)
+{
+    const unsigned hash = (unsigned) col * 73856093u ^ (unsigned) row * 19349663u;
+    return (int) (hash % grid->buckets);
+}
+
+static int grid_bucket_at(const Grid *grid, Vec2 pos)
+{
+    return grid_bucket(grid, grid_coordinate(grid, pos.x), grid_coordinate(grid, pos.y));
+}
+
+/**
+ * @param width, height : float Area whose cells get a bucket each
+ * @param cell_size : float Side of a cell, ideally the hit box size
+ * @param capacity : size_t Indices go from 0 to capacity - 1
+ * @return the grid or NULL when out of memory
+ */
+Grid *grid_create(float width, float height, float cell_size, size_t capacity)
+{
+    Grid *grid = calloc(1, sizeof(Grid));
+    if (grid == NULL)
+        return NULL;
+
+    grid->cell_size = cell_size;
+    const size_t cols = (size_t) fmaxf(ceilf(width / cell_size), 1.0f);
+    const size_t rows = (size_t) fmaxf(ceilf(height / cell_size), 1.0f);
+    grid->buckets = cols * rows;
+    grid->capacity = capacity;
+
+    grid->heads = malloc(grid->buckets * sizeof(int));
+    grid->next = malloc(capacity * sizeof(int));
+    grid->prev = malloc(capacity * sizeof(int));
+    grid->cells = malloc(capacity * sizeof(int));
+    if (grid->heads == NULL || grid->next == NULL
+        || grid->prev == NULL || grid->cells == NULL)
+    {
+        grid_destroy(grid);
+        return NULL;
+    }
+
+    grid_clear(grid);
+    return grid;
+}
+
+void grid_destroy(Grid *grid)
+{
+    if (grid == NULL)
+        return;
+
+    free(grid->heads);
+    free(grid->next);
+    free(grid->prev);
+    free(grid->cells);
+    free(grid);
+}
+
+/**
+ * Makes room for indices up to capacity - 1, keeping the ones in the grid
+ * @return 1 on success, 0 when out of memory
+ */
+int grid_reserve(Grid *grid, size_t capacity)
+{
+    if (capacity <= grid->capacity)
+        return 1;
+
+    int *next = realloc(grid->next, capacity * sizeof(int));
+    if (next == NULL)
+        return 0;
+    grid->next = next;
+
+    int *prev = realloc(grid->prev, capacity * sizeof(int));
+    if (prev == NULL)
+        return 0;
+    grid->prev = prev;
+
+    int *cells = realloc(grid->cells, capacity * sizeof(int));
+    if (cells == NULL)
+        return 0;
+    grid->cells = cells;
+
+    for (size_t i = grid->capacity; i < capacity; i++)
+        grid->cells[i] = -1;
+    grid->capacity = capacity;
+    return 1;
+}
+
+void grid_clear(Grid *grid)
+{
+    for (size_t i = 0; i < grid->buckets; i++)
+        grid->heads[i] = -1;
+    for (size_t i = 0; i < grid->capacity; i++)
+        grid->cells[i] = -1;
+}
+
+void grid_insert(Grid *grid, size_t index, Vec2 pos)
+{
+    const int cell = grid_bucket_at(grid, pos);
+    const int head = grid->heads[cell];
+
+    grid->cells[index] = cell;
+    grid->prev[index] = -1;
+    grid->next[index] = head;
+    if (head >= 0)
+        grid->prev[head] = (int) index;
+    grid->heads[cell] = (int) index;
+}
+
+/* Inserts the indices first to first + count - 1 at points[0..count) */
+void grid_insert_range(Grid *grid, size_t first, const Vec2 *points, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        grid_insert(grid, first + i, points[i]);
+}
+
+void grid_remove(Grid *grid, size_t index)
+{
+    const int cell = grid->cells[index];
+    if (cell < 0)
+        return;
+
+    const int prev = grid->prev[index];
+    const int next = grid->next[index];
+    if (prev >= 0)
+        grid->next[prev] = next;
+    else
+        grid->heads[cell] = next;
+    if (next >= 0)
+        grid->prev[next] = prev;
+    grid->cells[index] = -1;
+}
+
+/* Relinks index only when it crosses into another bucket */
+void grid_move(Grid *grid, size_t index, Vec2 pos)
+{
+    const int cell = grid_bucket_at(grid, pos);
+    if (grid->cells[index] == cell)
+        return;
+
+    grid_remove(grid, index);
+    grid_insert(grid, index, pos);
+}
+
+/* Lowest of hit and the indices of a bucket whose hit box contains pos */
+static int grid_hit_bucket(const Grid *grid, const Vec2 *points, int bucket,
+        Vec2 pos, float half_size, int hit)
+{
+    for (int i = grid->heads[bucket]; i >= 0; i = grid->next[i])
+    {
+        if (pos.x >= points[i].x - half_size && pos.x <= points[i].x + half_size
+            && pos.y >= points[i].y - half_size && pos.y <= points[i].y + half_size
+            && (hit < 0 || i < hit))
+        {
+            hit = i;
+        }
+    }
+    return hit;
+}
+
+/**
+ * Finds the point whose square hit box of half_size around it contains
+ * pos, looking only at the cells the box can reach. With cells at least
+ * 2 * half_size wide those are at most 2x2 cells, a box reaching more
+ * cells than there are buckets looks at every bucket once instead.
+ * @param points : Vec2 Positions of the indices in the grid
+ * @param pos : Vec2 Position to test
+ * @param half_size : float Half the side of the hit box
+ * @return lowest index that was hit, -1 if none
+ */
+int grid_hit(const Grid *grid, const Vec2 *points, Vec2 pos, float half_size)
+{
+    const int col_begin = grid_coordinate(grid, pos.x - half_size);
+    const int col_end = grid_coordinate(grid, pos.x + half_size);
+    const int row_begin = grid_coordinate(grid, pos.y - half_size);
+    const int row_end = grid_coordinate(grid, pos.y + half_size);
+    const double cells = ((double) col_end - col_begin + 1) * ((double) row_end - row_begin + 1);
+
+    int hit = -1;
+    if (cells >= (double) grid->buckets)
+    {
+        for (size_t bucket = 0; bucket < grid->buckets; bucket++)
+            hit = grid_hit_bucket(grid, points, (int) bucket, pos, half_size, hit);
+        return hit;
+    }
+
+    /* Cells sharing a bucket may visit it twice, which finds the same hit */
+    for (int row = row_begin; row <= row_end; row++)
+    {
+        for (int col = col_begin; col <= col_end; col++)
+            hit = grid_hit_bucket(grid, points, grid_bucket(grid, col, row), pos, half_size, hit);
+    }
+    return hit;
+}
@@ -0,0 +1,32 @@
+/* Uniform grid for hit testing points
+ *
+ * Buckets point indices into square cells, so finding the points near a
+ * position only looks at a couple of cells instead of every point. The
+ * cells cover the whole plane: the coordinates of a cell are hashed into
+ * a fixed number of buckets, as many as the cells of the area the grid is
+ * created for, so panned, zoomed or imported points anywhere spread out
+ * instead of piling up at the border of the screen. Cells sharing a
+ * bucket only cost a few more comparisons.
+ * The grid only stores indices, the positions stay with the caller.
+ */
+
+#ifndef GRID_H_
+#define GRID_H_
+
+#include "bezier.h"
+
+typedef struct Grid Grid;
+
+Grid *grid_create(float width, float height, float cell_size, size_t capacity);
+void grid_destroy(Grid *grid);
+int grid_reserve(Grid *grid, size_t capacity);
+
+void grid_clear(Grid *grid);
+void grid_insert(Grid *grid, size_t index, Vec2 pos);
+void grid_insert_range(Grid *grid, size_t first, const Vec2 *points, size_t count);
+void grid_move(Grid *grid, size_t index, Vec2 pos);
+void grid_remove(Grid *grid, size_t index);
+
+int grid_hit(const Grid *grid, const Vec2 *points, Vec2 pos, float half_size);
+
+#endif // GRID_H_
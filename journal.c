@@ -0,0 +1,279 @@
+/* Journal of the input events of an interactive session, see journal.h */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "journal.h"
+
+const char *journal_kind_names[JOURNAL_KINDS_COUNT] = {
+    "key down",
+    "button down",
+    "button up",
+    "motion",
+    "wheel",
+};
+
+/**
+ * Kind of the record an event is journaled as
+ * @return the JournalKind, -1 for events that aren't journaled
+ */
+int journal_kind(const SDL_Event *event)
+{
+    switch (event->type)
+    {
+        case SDL_KEYDOWN:
+            return JOURNAL_KEY_DOWN;
+        case SDL_MOUSEBUTTONDOWN:
+            return JOURNAL_BUTTON_DOWN;
+        case SDL_MOUSEBUTTONUP:
+            return JOURNAL_BUTTON_UP;
+        case SDL_MOUSEMOTION:
+            return JOURNAL_MOTION;
+        case SDL_MOUSEWHEEL:
+            return JOURNAL_WHEEL;
+    }
+    return -1;
+}
+
+static void put_le16(Uint8 *p, Uint16 value)
+{
+    p[0] = (Uint8) value;
+    p[1] = (Uint8) (value >> 8);
+}
+
+static Uint16 get_le16(const Uint8 *p)
+{
+    return (Uint16) (p[0] | p[1] << 8);
+}
+
+static Uint32 get_le32(const Uint8 *p)
+{
+    return get_le16(p) | (Uint32) get_le16(p + 2) << 16;
+}
+
+/* Coordinates outside of a Sint16 only happen far off the window */
+static Uint16 journal_coordinate(Sint32 value)
+{
+    if (value < -32768)
+        value = -32768;
+    else if (value > 32767)
+        value = 32767;
+    return (Uint16) (Sint16) value;
+}
+
+static void journal_flush(Journal *journal)
+{
+    if (journal->ok && journal->size > 0
+        && SDL_RWwrite(journal->rw, journal->data, 1, journal->size) != journal->size)
+        journal->ok = 0;
+    journal->size = 0;
+}
+
+/**
+ * Creates a journal file to record into
+ * @param file : const char Path of the journal, replaced if it exists
+ * @return 1 on success, 0 on error, see SDL_GetError
+ */
+int journal_record_open(Journal *journal, const char *file)
+{
+    memset(journal, 0, sizeof(Journal));
+    journal->data = malloc(JOURNAL_CHUNK);
+    if (journal->data == NULL)
+    {
+        SDL_OutOfMemory();
+        return 0;
+    }
+
+    journal->rw = SDL_RWFromFile(file, "wb");
+    if (journal->rw == NULL)
+    {
+        free(journal->data);
+        journal->data = NULL;
+        return 0;
+    }
+
+    journal->ok = SDL_RWwrite(journal->rw, JOURNAL_FILE_MAGIC, 4, 1) == 1
+        && SDL_WriteLE32(journal->rw, JOURNAL_FILE_VERSION) == 1;
+    journal->last_timestamp = SDL_GetTicks();
+    return 1;
+}
+
+/**
+ * Appends an event to the journal, events that aren't journaled are
+ * ignored. Write errors are only reported by journal_record_close.
+ * @param mod : SDL_Keymod Modifier keys held during the event
+ */
+void journal_record(Journal *journal, const SDL_Event *event, SDL_Keymod mod)
+{
+    const int kind = journal_kind(event);
+    if (kind < 0)
+        return;
+
+    if (journal->size + JOURNAL_RECORD_SIZE > JOURNAL_CHUNK)
+        journal_flush(journal);
+
+    Uint8 button = 0;
+    Sint32 x = 0;
+    Sint32 y = 0;
+    switch (kind)
+    {
+        case JOURNAL_KEY_DOWN:
+            x = (Sint32) (Uint16) event->key.keysym.sym;
+            y = (Sint32) (Uint16) ((Uint32) event->key.keysym.sym >> 16);
+            break;
+        case JOURNAL_BUTTON_DOWN:
+        case JOURNAL_BUTTON_UP:
+            button = event->button.button;
+            x = event->button.x;
+            y = event->button.y;
+            break;
+        case JOURNAL_MOTION:
+            x = event->motion.x;
+            y = event->motion.y;
+            break;
+        case JOURNAL_WHEEL:
+            y = event->wheel.y;
+            break;
+    }
+
+    const Uint32 elapsed = event->common.timestamp - journal->last_timestamp;
+    journal->last_timestamp = event->common.timestamp;
+
+    Uint8 *record = journal->data + journal->size;
+    record[0] = (Uint8) kind;
+    record[1] = button;
+    put_le16(record + 2, (Uint16) mod);
+    put_le16(record + 4, (Uint16) (elapsed < 0xFFFF ? elapsed : 0xFFFF));
+    put_le16(record + 6, kind == JOURNAL_KEY_DOWN ? (Uint16) x : journal_coordinate(x));
+    put_le16(record + 8, kind == JOURNAL_KEY_DOWN ? (Uint16) y : journal_coordinate(y));
+    journal->size += JOURNAL_RECORD_SIZE;
+}
+
+/**
+ * Writes what is still buffered and closes the file
+ * @return 1 if every record was written, 0 otherwise, see SDL_GetError
+ */
+int journal_record_close(Journal *journal, const char *file)
+{
+    journal_flush(journal);
+    int ok = journal->ok;
+    if (!ok)
+        SDL_SetError("couldn't write %s", file);
+    if (SDL_RWclose(journal->rw) < 0)
+        ok = 0;
+    free(journal->data);
+    memset(journal, 0, sizeof(Journal));
+    return ok;
+}
+
+/**
+ * Reads a whole journal file into memory to replay it
+ * @param file : const char Path of the journal
+ * @return 1 on success, 0 on error, see SDL_GetError
+ */
+int journal_replay_open(Journal *journal, const char *file)
+{
+    memset(journal, 0, sizeof(Journal));
+    SDL_RWops *rw = SDL_RWFromFile(file, "rb");
+    if (rw == NULL)
+        return 0;
+
+    const Sint64 size = SDL_RWsize(rw);
+    int ok = size >= 8;
+    if (!ok)
+        SDL_SetError("%s is not a journal file", file);
+    else
+    {
+        journal->data = malloc((size_t) size);
+        ok = journal->data != NULL;
+        if (!ok)
+            SDL_OutOfMemory();
+    }
+    if (ok && SDL_RWread(rw, journal->data, 1, (size_t) size) != (size_t) size)
+    {
+        SDL_SetError("couldn't read %s", file);
+        ok = 0;
+    }
+    SDL_RWclose(rw);
+
+    if (ok && memcmp(journal->data, JOURNAL_FILE_MAGIC, 4) != 0)
+    {
+        SDL_SetError("%s is not a journal file", file);
+        ok = 0;
+    }
+    if (ok && get_le32(journal->data + 4) != JOURNAL_FILE_VERSION)
+    {
+        SDL_SetError("%s has an unsupported version", file);
+        ok = 0;
+    }
+    if (!ok)
+    {
+        journal_replay_close(journal);
+        return 0;
+    }
+
+    journal->size = (size_t) size;
+    journal->pos = 8;
+    return 1;
+}
+
+/**
+ * Rebuilds the next event of the journal, a truncated last record is
+ * dropped. The timestamp of the event is 0, the recorded delays add
+ * up in recorded_ms.
+ * @param mod : SDL_Keymod Set to the modifier keys held during the event
+ * @return 1 with the event, 0 at the end of the journal
+ */
+int journal_replay_next(Journal *journal, SDL_Event *event, SDL_Keymod *mod)
+{
+    while (journal->pos + JOURNAL_RECORD_SIZE <= journal->size)
+    {
+        const Uint8 *record = journal->data + journal->pos;
+        journal->pos += JOURNAL_RECORD_SIZE;
+
+        const Sint16 x = (Sint16) get_le16(record + 6);
+        const Sint16 y = (Sint16) get_le16(record + 8);
+        memset(event, 0, sizeof(SDL_Event));
+        *mod = (SDL_Keymod) get_le16(record + 2);
+        journal->recorded_ms += get_le16(record + 4);
+        switch (record[0])
+        {
+            case JOURNAL_KEY_DOWN:
+                event->type = SDL_KEYDOWN;
+                event->key.state = SDL_PRESSED;
+                event->key.keysym.sym = (SDL_Keycode) get_le32(record + 6);
+                return 1;
+            case JOURNAL_BUTTON_DOWN:
+            case JOURNAL_BUTTON_UP:
+                event->type = record[0] == JOURNAL_BUTTON_DOWN
+                    ? SDL_MOUSEBUTTONDOWN
+                    : SDL_MOUSEBUTTONUP;
+                event->button.state = record[0] == JOURNAL_BUTTON_DOWN
+                    ? SDL_PRESSED
+                    : SDL_RELEASED;
+                event->button.button = record[1];
+                event->button.x = x;
+                event->button.y = y;
+                return 1;
+            case JOURNAL_MOTION:
+                event->type = SDL_MOUSEMOTION;
+                event->motion.x = x;
+                event->motion.y = y;
+                return 1;
+            case JOURNAL_WHEEL:
+                event->type = SDL_MOUSEWHEEL;
+                event->wheel.y = y;
+                return 1;
+        }
+        /* Unknown kinds are skipped */
+    }
+    return 0;
+}
+
+void journal_replay_close(Journal *journal)
+{
+    free(journal->data);
+    memset(journal, 0, sizeof(Journal));
+}
@@ -0,0 +1,74 @@
+/* Journal of the input events of an interactive session
+ *
+ * Recording appends the events the main loop reacts to, key presses,
+ * mouse buttons, motion and the wheel, to a binary file. Replaying
+ * hands them back one at a time, so a session can be fed through the
+ * loop again as often as needed.
+ *
+ * Journal files are little endian:
+ *
+ *     char   magic[4]    "BEZJ"
+ *     uint32 version     JOURNAL_FILE_VERSION
+ *     then JOURNAL_RECORD_SIZE bytes for every event
+ *     uint8  kind        JournalKind
+ *     uint8  button      mouse button of a button press or release
+ *     uint16 mod         SDL_Keymod at the time of the event
+ *     uint16 delay       ms since the previous event, at most 65535
+ *     int16  x, y        logical pixels, the wheel scroll in y
+ *
+ * A key press stores the low and high 16 bits of its keycode in x, y.
+ */
+
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include "SDL.h"
+
+#define JOURNAL_FILE_MAGIC "BEZJ"
+#define JOURNAL_FILE_VERSION 1
+#define JOURNAL_RECORD_SIZE 10
+/* Bytes of records buffered before a write */
+#define JOURNAL_CHUNK (64 * 1024)
+
+typedef enum JournalKind
+{
+    JOURNAL_KEY_DOWN,
+    JOURNAL_BUTTON_DOWN,
+    JOURNAL_BUTTON_UP,
+    JOURNAL_MOTION,
+    JOURNAL_WHEEL,
+    JOURNAL_KINDS_COUNT,
+} JournalKind;
+
+extern const char *journal_kind_names[JOURNAL_KINDS_COUNT];
+
+/**
+ * A journal open for recording or for replaying, never both. A replayed
+ * journal is read into memory when it is opened, so replaying never
+ * waits for the disk.
+ */
+typedef struct Journal
+{
+    SDL_RWops *rw;
+    int ok;
+    Uint32 last_timestamp;
+
+    /* Records buffered for writing, or the whole file being replayed */
+    Uint8 *data;
+    size_t size;
+    size_t pos;
+    /* Length of the replayed part of the session as it was recorded */
+    Uint64 recorded_ms;
+} Journal;
+
+int journal_kind(const SDL_Event *event);
+
+int journal_record_open(Journal *journal, const char *file);
+void journal_record(Journal *journal, const SDL_Event *event, SDL_Keymod mod);
+int journal_record_close(Journal *journal, const char *file);
+
+int journal_replay_open(Journal *journal, const char *file);
+int journal_replay_next(Journal *journal, SDL_Event *event, SDL_Keymod *mod);
+void journal_replay_close(Journal *journal);
+
+#endif // JOURNAL_H_
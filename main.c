@@ -8,20 +8,39 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 
 #include "SDL.h"
 
+#include "bezier.h"
+#include "fill.h"
+#include "journal.h"
+#include "pool.h"
+#include "scene.h"
+#include "stroke.h"
+#include "text.h"
+
 #define SCREEN_WIDTH 640
 #define SCREEN_HEIGHT 480
 #define SCREEN_FPS 60
 #define DELTA_TIME_SEC (1.0f / SCREEN_FPS)
-#define DELTA_TIME_MS ((Uint32)floorf(DELTA_TIME_SEC * 1000.0f))
 #define MARKER_SIZE 15.0f
+/* Default width of thick curves in logical units */
+#define LINE_WIDTH 2.0f
+/* Anti-aliasing fringe of thick curves in window pixels */
+#define LINE_FRINGE 1.0f
+/* Where S saves the scene without --scene */
+#define SCENE_FILE_DEFAULT "scene.bez"
+/* Where E exports the curves without --export */
+#define EXPORT_FILE_DEFAULT "curves.svg"
+/* How long an idle main loop blocks waiting for events */
+#define IDLE_TIMEOUT_MS 250
 
 #define BACKGROUND_COLOR    0x353535FF
 #define RED_COLOR          0xDA2C38FF
 #define GREEN_COLOR          0x87C38FFF
 #define BLUE_COLOR          0x748CABFF
+#define YELLOW_COLOR          0xE8C547FF
 
 #define HEX_COLOR(hex)                      \
     ((hex) >> (3 * 8)) & 0xFF,              \
@@ -48,218 +67,1148 @@ void *check_sdl_ptr(void *ptr)
 }
 
 
-float lerpf(float a, float b, float t)
+typedef union Color
+{
+    uint32_t  hex_color;
+    SDL_Color color;
+} Color;
+
+/* The bytes of hex_color are in host order, not r, g, b, a */
+SDL_Color color_sdl(Color color)
 {
-    return a + (b - a) * t;
+    return (SDL_Color) {HEX_COLOR(color.hex_color)};
 }
 
-typedef struct Vec2 
+/* Zoom range of the camera and the factor of one wheel notch */
+#define CAMERA_ZOOM_MIN (1.0f / 64.0f)
+#define CAMERA_ZOOM_MAX 64.0f
+#define CAMERA_ZOOM_STEP 1.25f
+
+/**
+ * View of the scene: a point p of the scene is drawn at
+ * (p - offset) * zoom in logical pixels
+ */
+typedef struct Camera
 {
-    float x;
-    float y;
-} Vec2;
+    Vec2 offset;
+    float zoom;
+} Camera;
 
-Vec2 vec2(float x, float y)
+Camera camera_identity(void)
 {
-    return (Vec2) {x, y};
+    return (Camera) {vec2(0.0f, 0.0f), 1.0f};
 }
 
-Vec2 vec2_add(Vec2 a, Vec2 b)
+Vec2 camera_to_screen(const Camera *camera, Vec2 p)
 {
-    return vec2(a.x + b.x, a.y + b.y);
+    return vec2_scale(vec2_sub(p, camera->offset), camera->zoom);
 }
 
-Vec2 vec2_sub(Vec2 a, Vec2 b)
+Vec2 camera_to_scene(const Camera *camera, Vec2 p)
 {
-    return vec2(a.x - b.x, a.y - b.y);
+    return vec2_add(vec2_scale(p, 1.0f / camera->zoom), camera->offset);
 }
 
-Vec2 vec2_scale(Vec2 a, float s)
+/**
+ * Camera showing the box min, max centered in a width x height view
+ * with margin logical pixels around it, as large as it fits
+ */
+Camera camera_fit(Vec2 min, Vec2 max, float width, float height, float margin)
 {
-    return vec2(a.x * s, a.y * s);
+    const float box_width = fmaxf(max.x - min.x, 1.0f);
+    const float box_height = fmaxf(max.y - min.y, 1.0f);
+    const float zoom = fminf((width - 2.0f * margin) / box_width,
+            (height - 2.0f * margin) / box_height);
+
+    const Vec2 center = vec2_scale(vec2_add(min, max), 0.5f);
+    const Vec2 half_view = vec2(width * 0.5f / zoom, height * 0.5f / zoom);
+    return (Camera) {vec2_sub(center, half_view), zoom};
 }
 
-Vec2 lerpv2(Vec2 a, Vec2 b, float t)
+/* Zooms by factor, keeping the scene point under screen where it is */
+void camera_zoom_at(Camera *camera, Vec2 screen, float factor)
 {
-    return vec2_add(a, vec2_scale(vec2_sub(b, a), t));
+    const Vec2 anchor = camera_to_scene(camera, screen);
+    camera->zoom = fminf(fmaxf(camera->zoom * factor, CAMERA_ZOOM_MIN), CAMERA_ZOOM_MAX);
+    camera->offset = vec2_sub(anchor, vec2_scale(screen, 1.0f / camera->zoom));
 }
 
-typedef union Color
+#define BATCH_GROUPS_CAPACITY 8
+#define BATCH_POINTS_CAPACITY 4096
+#define BATCH_STRIPS_CAPACITY 64
+#define BATCH_RECTS_CAPACITY 2048
+
+/* Markers are quads textured with a baked marker where SDL has
+ * SDL_RenderGeometry, all colors in one draw call */
+#ifdef STROKE_GEOMETRY
+#define BATCH_MARKER_GEOMETRY
+#define BATCH_MARKERS_CAPACITY 4096
+/* Side of the baked marker, the outermost texel ring is transparent
+ * so the filtered edges come out anti-aliased */
+#define MARKER_TEXTURE_SIZE 32
+#endif
+
+/**
+ * Geometry of one color collected during a frame.
+ * Line strips are stored back to back in points, strips[i] is the
+ * offset one past the last point of the i-th strip.
+ */
+typedef struct BatchGroup
 {
-    uint32_t  hex_color;
-    SDL_Color color;
-} Color;
+    Color color;
+    SDL_FPoint points[BATCH_POINTS_CAPACITY];
+    size_t points_count;
+    size_t strips[BATCH_STRIPS_CAPACITY];
+    size_t strips_count;
+    SDL_FRect rects[BATCH_RECTS_CAPACITY];
+    size_t rects_count;
+} BatchGroup;
 
-void render_line(SDL_Renderer *renderer, Vec2 begin, Vec2 end, Color color)
+/**
+ * Per-frame geometry batcher, so each color costs a single
+ * SDL_SetRenderDrawColor plus one draw call per primitive kind
+ * instead of one of each for every line and marker
+ */
+typedef struct Batch
 {
+    SDL_Renderer *renderer;
+    /* Everything queued is in scene coordinates, seen through it */
+    Camera camera;
+    BatchGroup groups[BATCH_GROUPS_CAPACITY];
+    size_t groups_count;
+
+#ifdef BATCH_MARKER_GEOMETRY
+    /* NULL if it couldn't be created, markers are rects then */
+    SDL_Texture *marker;
+    SDL_Vertex marker_vertices[BATCH_MARKERS_CAPACITY * 4];
+    int marker_indices[BATCH_MARKERS_CAPACITY * 6];
+    size_t markers_count;
+#endif
+} Batch;
+
+#ifdef BATCH_MARKER_GEOMETRY
+/* Bakes a white marker, vertex colors tint it when drawing */
+SDL_Texture *batch_bake_marker(SDL_Renderer *renderer)
+{
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+            SDL_TEXTUREACCESS_STATIC, MARKER_TEXTURE_SIZE, MARKER_TEXTURE_SIZE);
+    if (texture == NULL)
+        return NULL;
 
-    check_sdl_code(
-            SDL_SetRenderDrawColor(renderer, HEX_COLOR(color.hex_color)));
+    static Uint8 pixels[MARKER_TEXTURE_SIZE * MARKER_TEXTURE_SIZE * 4];
+    for (int y = 0; y < MARKER_TEXTURE_SIZE; y++)
+    {
+        for (int x = 0; x < MARKER_TEXTURE_SIZE; x++)
+        {
+            const int border = x == 0 || y == 0
+                || x == MARKER_TEXTURE_SIZE - 1 || y == MARKER_TEXTURE_SIZE - 1;
+            Uint8 *pixel = pixels + (y * MARKER_TEXTURE_SIZE + x) * 4;
+            pixel[0] = pixel[1] = pixel[2] = 0xFF;
+            pixel[3] = border ? 0x00 : 0xFF;
+        }
+    }
 
-    check_sdl_code(
-        SDL_RenderDrawLineF(
-            renderer, 
-            (int) floorf(begin.x), 
-            (int) floorf(begin.y), 
-            (int) floorf(end.x), 
-            (int) floorf(end.y)
-    ));
+    if (SDL_UpdateTexture(texture, NULL, pixels, MARKER_TEXTURE_SIZE * 4) < 0
+        || SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND) < 0)
+    {
+        SDL_DestroyTexture(texture);
+        return NULL;
+    }
+    return texture;
+}
+#endif
+
+void batch_init(Batch *batch, SDL_Renderer *renderer)
+{
+    batch->renderer = renderer;
+    batch->camera = camera_identity();
+    batch->groups_count = 0;
+
+#ifdef BATCH_MARKER_GEOMETRY
+    batch->marker = batch_bake_marker(renderer);
+    batch->markers_count = 0;
+
+    /* Every marker is the same two triangles, only the vertices change */
+    for (int i = 0; i < BATCH_MARKERS_CAPACITY; i++)
+    {
+        int *index = batch->marker_indices + i * 6;
+        index[0] = i * 4 + 0;
+        index[1] = i * 4 + 1;
+        index[2] = i * 4 + 2;
+        index[3] = i * 4 + 0;
+        index[4] = i * 4 + 2;
+        index[5] = i * 4 + 3;
+    }
+#endif
+}
 
+void batch_destroy(Batch *batch)
+{
+#ifdef BATCH_MARKER_GEOMETRY
+    if (batch->marker != NULL)
+        SDL_DestroyTexture(batch->marker);
+#else
+    (void) batch;
+#endif
 }
 
-void fill_rect(SDL_Renderer *renderer, Vec2 pos, Vec2 size, Color color)
+/**
+ * Draws everything collected so far, groups in the order their color
+ * was first used, and empties the batch
+ */
+void batch_flush(Batch *batch)
 {
-    check_sdl_code(
-            SDL_SetRenderDrawColor(renderer, HEX_COLOR(color.hex_color))
-    );
+    for (size_t i = 0; i < batch->groups_count; i++)
+    {
+        BatchGroup *group = &batch->groups[i];
 
-    const SDL_Rect rect = (SDL_Rect) {
-        (int) floorf(pos.x), 
-        (int) floorf(pos.y), 
-        (int) floorf(size.x), 
-        (int) floorf(size.y)
-    };
-    check_sdl_code(SDL_RenderFillRect(renderer, &rect));
+        check_sdl_code(
+                SDL_SetRenderDrawColor(batch->renderer, HEX_COLOR(group->color.hex_color)));
+
+        size_t begin = 0;
+        for (size_t j = 0; j < group->strips_count; j++)
+        {
+            check_sdl_code(
+                SDL_RenderDrawLinesF(
+                    batch->renderer,
+                    group->points + begin,
+                    (int) (group->strips[j] - begin)));
+            begin = group->strips[j];
+        }
+
+        if (group->rects_count > 0)
+        {
+            check_sdl_code(
+                SDL_RenderFillRectsF(
+                    batch->renderer,
+                    group->rects,
+                    (int) group->rects_count));
+        }
+    }
+    batch->groups_count = 0;
+
+#ifdef BATCH_MARKER_GEOMETRY
+    if (batch->markers_count > 0)
+    {
+        check_sdl_code(
+            SDL_RenderGeometry(
+                batch->renderer, batch->marker,
+                batch->marker_vertices, (int) batch->markers_count * 4,
+                batch->marker_indices, (int) batch->markers_count * 6));
+        batch->markers_count = 0;
+    }
+#endif
+}
+
+/**
+ * Finds the group of the given color or starts a new one,
+ * flushing the batch when there is no room left for another color
+ */
+BatchGroup *batch_group(Batch *batch, Color color)
+{
+    for (size_t i = 0; i < batch->groups_count; i++)
+    {
+        if (batch->groups[i].color.hex_color == color.hex_color)
+            return &batch->groups[i];
+    }
+
+    if (batch->groups_count >= BATCH_GROUPS_CAPACITY)
+        batch_flush(batch);
+
+    BatchGroup *group = &batch->groups[batch->groups_count++];
+    group->color = color;
+    group->points_count = 0;
+    group->strips_count = 0;
+    group->rects_count = 0;
+    return group;
+}
+
+/**
+ * Queues a connected line strip through the given points.
+ * Strips that don't fit are split, the next part starting again
+ * at the last queued point so the strip stays connected.
+ */
+void batch_line_strip(Batch *batch, const Vec2 *points, size_t count, Color color)
+{
+    size_t i = 0;
+    while (count - i >= 2)
+    {
+        BatchGroup *group = batch_group(batch, color);
+        if (group->strips_count >= BATCH_STRIPS_CAPACITY
+            || BATCH_POINTS_CAPACITY - group->points_count < 2)
+        {
+            batch_flush(batch);
+            group = batch_group(batch, color);
+        }
+
+        size_t take = BATCH_POINTS_CAPACITY - group->points_count;
+        if (take > count - i)
+            take = count - i;
+
+        for (size_t j = 0; j < take; j++)
+        {
+            const Vec2 p = camera_to_screen(&batch->camera, points[i + j]);
+            group->points[group->points_count++] = (SDL_FPoint) {p.x, p.y};
+        }
+        group->strips[group->strips_count++] = group->points_count;
+
+        i += take - 1;
+    }
 }
 
-/* Will draw a rectangle with the position as the center
- * @param renderer : SDL_Renderer pointer 
+/* Will queue a rectangle with the position as the center,
+ * the same size on screen at every zoom
+ * @param batch : Batch pointer
  * @param position : Vec2
  * @param color : Color
  */
-void render_marker(SDL_Renderer *renderer, Vec2 position, Color color)
+void batch_marker(Batch *batch, Vec2 position, Color color)
 {
-    const Vec2 size = vec2(MARKER_SIZE, MARKER_SIZE);
-    fill_rect(
-        renderer, 
-        vec2_sub(position, vec2_scale(size, 0.5f)), 
-        size, 
-        color
-    );
+    position = camera_to_screen(&batch->camera, position);
+#ifdef BATCH_MARKER_GEOMETRY
+    if (batch->marker != NULL)
+    {
+        if (batch->markers_count >= BATCH_MARKERS_CAPACITY)
+            batch_flush(batch);
+
+        const float h = MARKER_SIZE * 0.5f;
+        const SDL_Color c = color_sdl(color);
+        SDL_Vertex *v = batch->marker_vertices + batch->markers_count * 4;
+        v[0] = (SDL_Vertex) {{position.x - h, position.y - h}, c, {0.0f, 0.0f}};
+        v[1] = (SDL_Vertex) {{position.x + h, position.y - h}, c, {1.0f, 0.0f}};
+        v[2] = (SDL_Vertex) {{position.x + h, position.y + h}, c, {1.0f, 1.0f}};
+        v[3] = (SDL_Vertex) {{position.x - h, position.y + h}, c, {0.0f, 1.0f}};
+        batch->markers_count++;
+        return;
+    }
+#endif
+
+    BatchGroup *group = batch_group(batch, color);
+    if (group->rects_count >= BATCH_RECTS_CAPACITY)
+    {
+        batch_flush(batch);
+        group = batch_group(batch, color);
+    }
+
+    group->rects[group->rects_count++] = (SDL_FRect) {
+        position.x - MARKER_SIZE * 0.5f,
+        position.y - MARKER_SIZE * 0.5f,
+        MARKER_SIZE,
+        MARKER_SIZE
+    };
+}
+
 
+/* Flatness tolerance of the adaptive mode in window pixels */
+#define ADAPTIVE_TOLERANCE 0.5f
+/* Flatness tolerance in logical units, the window may be scaled */
+float adaptive_tolerance(SDL_Renderer *renderer)
+{
+    float scale_x, scale_y;
+    SDL_RenderGetScale(renderer, &scale_x, &scale_y);
+    return ADAPTIVE_TOLERANCE / fmaxf(scale_x, scale_y);
 }
 
+/* Opacity of filled curves */
+#define FILL_ALPHA 0x60
+
+/* Logical pixels per second the animated marker travels */
+#define ANIMATION_SPEED 150.0f
+/* Above this many points only the travelling marker is drawn,
+ * the construction would be n^2 / 2 lines */
+#define CONSTRUCTION_MAX_POINTS 64
 
 /**
- * Bezier Sample that works with arbitrary number of points
- * Points: a,b,c,d
- * we will be collapsing things together
- * So interpolate b/w a & b and store in a
- *
- * @Update: Instead of collapsing given buffer, memcopies it into
- * another buffer
- * 
- * @param ps : Vec2 Original points
- * @param xs : Vec2 Intermediate buffer for interpolated points
- * @param n : size_t Number of points
- * @param p : float Interpolation value
+ * Draws markers on the Bezier curve from 4 points a,b,c,d
+ * @update: works with arbitrary no. of points
+ * @update: reads the points from the sample cache
  */
+void render_bezier_markers(Batch *batch,
+        const SampleCache *cache, Color color)
+{
+    for (size_t i = 0; i <= cache->count; i++)
+    {
+        batch_marker(batch, cache->samples[i], color);
+    }
+}
+
+void render_bezier_curve(Batch *batch,
+        const SampleCache *cache, Color color)
+{
+    batch_line_strip(batch, cache->samples, cache->count + 1, color);
+}
+
+#ifdef STROKE_GEOMETRY
+/**
+ * Draws the curve as a thick, anti-aliased stroke in one draw call.
+ * The mesh is only rebuilt when the samples, the style or the camera
+ * of the batch changed,
+ * if it can't grow the curve falls back to 1 px lines.
+ */
+void render_bezier_stroke(Batch *batch, Stroke *stroke,
+        const SampleCache *cache, float width, float fringe, Color color)
+{
+    const Camera *camera = &batch->camera;
+    if (stroke == NULL
+        || !stroke_update(stroke, cache->version, cache->samples, cache->count + 1,
+            camera->offset, camera->zoom, width, fringe, color_sdl(color)))
+    {
+        render_bezier_curve(batch, cache, color);
+        return;
+    }
+    check_sdl_code(stroke_draw(stroke, batch->renderer));
+}
+#endif
+
+/**
+ * Draws a marker travelling along the curve at constant speed and the
+ * de Casteljau construction of its point. The curve is never resampled:
+ * the distance travelled by time t goes through the arc length table,
+ * O(log n), and only the points of the construction are computed.
+ * A chain of cubics only shows the construction of the current cubic.
+ * @param curve : Curve pointer, must have at least one point
+ * @param t : float Seconds since the start
+ */
+void render_bezier_animation(Batch *batch, Curve *curve, Pool *pool,
+        int piecewise, float t)
+{
+    static Vec2 levels[CONSTRUCTION_MAX_POINTS * (CONSTRUCTION_MAX_POINTS - 1) / 2];
+
+    curve_arc_update(curve, pool, piecewise);
+    const float length = curve_arc_length(curve);
+    const float distance = length > 0.0f ? fmodf(t * ANIMATION_SPEED, length) : 0.0f;
+    float p = curve_arc_param(curve, distance);
+
+    const Vec2 *ps = curve->ps;
+    size_t n = curve->count;
+    if (piecewise && n > 1)
+    {
+        const size_t segment = bezier_chain_segment(n, p);
+        ps += segment * 3;
+        n = n - segment * 3 < 4 ? n - segment * 3 : 4;
+        p -= (float) segment;
+    }
+
+    if (n < 2 || n > CONSTRUCTION_MAX_POINTS)
+    {
+        batch_marker(batch, curve_arc_point(curve, distance), (Color){YELLOW_COLOR});
+        return;
+    }
+
+    bezier_construction(ps, n, p, levels);
+    const Vec2 *level = levels;
+    for (size_t m = n - 1; m > 1; m--)
+    {
+        batch_line_strip(batch, level, m, (Color){YELLOW_COLOR});
+        level += m;
+    }
+    batch_marker(batch, *level, (Color){YELLOW_COLOR});
+}
+
+
+typedef enum FrameMode
+{
+    FRAME_CAPPED,   /* sleep what is left of DELTA_TIME_SEC after each frame */
+    FRAME_VSYNC,    /* let SDL_RenderPresent wait for the display */
+    FRAME_UNCAPPED, /* redraw as fast as possible, for benchmarking */
+    FRAME_REPLAY,   /* never sleep, only redraw after the events that need it */
+} FrameMode;
+
+/**
+ * Paces frames with the high resolution performance counter,
+ * so the time spent rendering is taken off the sleep
+ */
+typedef struct FrameLimiter
+{
+    FrameMode mode;
+    Uint64 frequency;
+    Uint64 period;
+    Uint64 frame_begin;
+    Uint64 last_tick;
+} FrameLimiter;
+
+void frame_limiter_init(FrameLimiter *limiter, FrameMode mode)
+{
+    limiter->mode = mode;
+    limiter->frequency = SDL_GetPerformanceFrequency();
+    limiter->period = (Uint64) (limiter->frequency * DELTA_TIME_SEC);
+    limiter->frame_begin = SDL_GetPerformanceCounter();
+    limiter->last_tick = limiter->frame_begin;
+}
+
+/* Marks the moment the loop woke up and started working on a frame */
+void frame_limiter_begin(FrameLimiter *limiter)
+{
+    limiter->frame_begin = SDL_GetPerformanceCounter();
+}
+
+/* Sleeps for whatever is left of the frame period after rendering */
+void frame_limiter_end(FrameLimiter *limiter)
+{
+    if (limiter->mode != FRAME_CAPPED)
+        return;
+
+    const Uint64 elapsed = SDL_GetPerformanceCounter() - limiter->frame_begin;
+    if (elapsed < limiter->period)
+    {
+        const Uint64 left = limiter->period - elapsed;
+        SDL_Delay((Uint32) (left * 1000 / limiter->frequency));
+    }
+}
+
+/**
+ * Seconds of wall clock time since the previous call
+ */
+float frame_limiter_tick(FrameLimiter *limiter)
+{
+    const Uint64 now = SDL_GetPerformanceCounter();
+    const float dt = (float) (now - limiter->last_tick) / (float) limiter->frequency;
+    limiter->last_tick = now;
+    return dt;
+}
 
-Vec2 beziern_sample(Vec2 *ps, Vec2 *xs, size_t n, float p)
+typedef enum ProfileSection
 {
+    PROFILE_EVENTS,
+    PROFILE_SAMPLING,
+    PROFILE_SUBMIT,
+    PROFILE_PRESENT,
+    PROFILE_FRAME,
+    PROFILE_SECTIONS_COUNT,
+} ProfileSection;
+
+const char *profile_section_names[PROFILE_SECTIONS_COUNT] = {
+    "events",
+    "sampling",
+    "submit",
+    "present",
+    "frame",
+};
+
+/* Number of frames the rolling statistics are computed over */
+#define PROFILE_HISTORY 128
+/* How often the window title is refreshed while profiling */
+#define PROFILE_TITLE_INTERVAL_SEC 0.5f
+
+/**
+ * Times the parts of every rendered frame with the performance counter.
+ * Time spent in a section is accumulated until profiler_frame_end, which
+ * pushes it into a ring buffer of the last PROFILE_HISTORY frames and
+ * optionally appends it as a row to a CSV file.
+ */
+typedef struct Profiler
+{
+    Uint64 frequency;
+    Uint64 begin[PROFILE_SECTIONS_COUNT];
+    Uint64 current[PROFILE_SECTIONS_COUNT];
+    size_t current_samples;
+
+    double history[PROFILE_SECTIONS_COUNT][PROFILE_HISTORY];
+    size_t history_samples[PROFILE_HISTORY];
+    size_t frames;
 
-   memcpy(xs, ps, n * sizeof(Vec2));
+    FILE *csv;
+} Profiler;
 
-   while (n > 1)
-   {
-        for (size_t i = 0; i < n - 1; i++)
+void profiler_init(Profiler *profiler, const char *csv_path)
+{
+    memset(profiler, 0, sizeof(*profiler));
+    profiler->frequency = SDL_GetPerformanceFrequency();
+
+    if (csv_path != NULL)
+    {
+        profiler->csv = fopen(csv_path, "w");
+        if (profiler->csv == NULL)
         {
-            xs[i] = lerpv2(xs[i], xs[i+1], p);
+            fprintf(stderr, "Could not open %s for writing\n", csv_path);
+            exit(1);
         }
-        n--;
-   }
-   return xs[0];
 
+        fprintf(profiler->csv, "frame");
+        for (size_t i = 0; i < PROFILE_SECTIONS_COUNT; i++)
+            fprintf(profiler->csv, ",%s_ms", profile_section_names[i]);
+        fprintf(profiler->csv, ",samples\n");
+    }
+}
+
+void profiler_close(Profiler *profiler)
+{
+    if (profiler->csv != NULL)
+        fclose(profiler->csv);
+    profiler->csv = NULL;
+}
+
+void profile_begin(Profiler *profiler, ProfileSection section)
+{
+    profiler->begin[section] = SDL_GetPerformanceCounter();
+}
+
+void profile_end(Profiler *profiler, ProfileSection section)
+{
+    profiler->current[section] += SDL_GetPerformanceCounter() - profiler->begin[section];
+}
+
+void profile_count_samples(Profiler *profiler, size_t samples)
+{
+    profiler->current_samples += samples;
+}
+
+/* Commits the sections timed since the previous rendered frame */
+void profiler_frame_end(Profiler *profiler)
+{
+    const size_t slot = profiler->frames % PROFILE_HISTORY;
+
+    for (size_t i = 0; i < PROFILE_SECTIONS_COUNT; i++)
+    {
+        profiler->history[i][slot] =
+            (double) profiler->current[i] * 1000.0 / (double) profiler->frequency;
+        profiler->current[i] = 0;
+    }
+    profiler->history_samples[slot] = profiler->current_samples;
+    profiler->current_samples = 0;
+
+    if (profiler->csv != NULL)
+    {
+        fprintf(profiler->csv, "%zu", profiler->frames);
+        for (size_t i = 0; i < PROFILE_SECTIONS_COUNT; i++)
+            fprintf(profiler->csv, ",%.4f", profiler->history[i][slot]);
+        fprintf(profiler->csv, ",%zu\n", profiler->history_samples[slot]);
+    }
+
+    profiler->frames++;
 }
 
+int compare_doubles(const void *a, const void *b)
+{
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
 
 /**
- * Returns a point after interpolation on given points a,b,c,d
+ * Rolling statistics of a section over the recorded history in ms
  */
-Vec2 bezier4_sample(Vec2 a, Vec2 b, Vec2 c, Vec2 d, float p)
+void profiler_stats(const Profiler *profiler, ProfileSection section,
+        double *min, double *avg, double *p99)
 {
-    Vec2 ps[4] = {a, b, c, d};
-    Vec2 xs[4];
-    return beziern_sample(ps, xs, 4, p);
-    // Phase 1
-    const Vec2 ab = lerpv2(a, b, p);
-    const Vec2 bc = lerpv2(b, c, p);
-    const Vec2 cd = lerpv2(c, d, p);
+    const size_t count = profiler->frames < PROFILE_HISTORY
+        ? profiler->frames
+        : PROFILE_HISTORY;
+    *min = *avg = *p99 = 0.0;
+    if (count == 0)
+        return;
+
+    double sorted[PROFILE_HISTORY];
+    memcpy(sorted, profiler->history[section], count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compare_doubles);
+
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++)
+        sum += sorted[i];
+
+    *min = sorted[0];
+    *avg = sum / (double) count;
+    *p99 = sorted[(count * 99 + 99) / 100 - 1];
+}
 
-    // Phase 2
-    const Vec2 abc = lerpv2(ab, bc, p);
-    const Vec2 bcd = lerpv2(bc, cd, p);
+/**
+ * Shows min/avg/p99 of every section and the average number of
+ * samples evaluated per frame in the window title
+ */
+void profiler_show(const Profiler *profiler, SDL_Window *window)
+{
+    char title[512];
+    size_t len = (size_t) snprintf(title, sizeof(title), "Bezier Curves");
 
-    // Phase 3
-    const Vec2 abcd = lerpv2(abc, bcd, p);
-    return abcd;
+    for (size_t i = 0; i < PROFILE_SECTIONS_COUNT && len < sizeof(title); i++)
+    {
+        double min, avg, p99;
+        profiler_stats(profiler, (ProfileSection) i, &min, &avg, &p99);
+        len += (size_t) snprintf(title + len, sizeof(title) - len,
+                " | %s %.2f/%.2f/%.2f", profile_section_names[i], min, avg, p99);
+    }
+
+    const size_t count = profiler->frames < PROFILE_HISTORY
+        ? profiler->frames
+        : PROFILE_HISTORY;
+    size_t samples = 0;
+    for (size_t i = 0; i < count; i++)
+        samples += profiler->history_samples[i];
+
+    if (len < sizeof(title))
+    {
+        snprintf(title + len, sizeof(title) - len,
+                " ms | %zu samples/frame", count > 0 ? samples / count : 0);
+    }
+    SDL_SetWindowTitle(window, title);
 }
 
 /**
- * Draws markers on the Bezier curve from 4 points a,b,c,d
- * @update: works with arbitrary no. of points
- *
- * @TODO: Make it work with arbitrary number of points
+ * Time a replay spent on every kind of journaled event: handling one
+ * and drawing the frame it asked for, from the performance counter
  */
-void render_bezier_markers(SDL_Renderer *renderer, 
-        Vec2 *ps, Vec2 *xs, size_t n,
-        float s, Color color)
+typedef struct ReplayStats
 {
-    for (float p = 0.0f+s; p <= 1.0f; p += s)
-    {
-        render_marker(renderer, beziern_sample(ps, xs, n, p), color);
+    Uint64 frequency;
+    Uint64 ticks[JOURNAL_KINDS_COUNT];
+    Uint64 max[JOURNAL_KINDS_COUNT];
+    size_t counts[JOURNAL_KINDS_COUNT];
+} ReplayStats;
+
+void replay_stats_init(ReplayStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->frequency = SDL_GetPerformanceFrequency();
+}
 
+void replay_stats_add(ReplayStats *stats, JournalKind kind, Uint64 ticks)
+{
+    stats->ticks[kind] += ticks;
+    if (ticks > stats->max[kind])
+        stats->max[kind] = ticks;
+    stats->counts[kind]++;
+}
+
+/* Prints count, total, average and maximum ms of every kind of event */
+void replay_stats_print(const ReplayStats *stats, const Journal *journal,
+        const char *file, size_t frames)
+{
+    const double ms = 1000.0 / (double) stats->frequency;
+    Uint64 ticks = 0;
+    Uint64 max = 0;
+    size_t count = 0;
+
+    printf("%s: %llu ms of recorded session, %zu frames\n", file,
+            (unsigned long long) journal->recorded_ms, frames);
+    printf("%-12s %8s %10s %8s %8s\n", "event", "count", "total_ms", "avg_ms", "max_ms");
+    for (size_t i = 0; i < JOURNAL_KINDS_COUNT; i++)
+    {
+        if (stats->counts[i] == 0)
+            continue;
+        printf("%-12s %8zu %10.2f %8.3f %8.3f\n", journal_kind_names[i], stats->counts[i],
+                (double) stats->ticks[i] * ms,
+                (double) stats->ticks[i] * ms / (double) stats->counts[i],
+                (double) stats->max[i] * ms);
+        ticks += stats->ticks[i];
+        count += stats->counts[i];
+        if (stats->max[i] > max)
+            max = stats->max[i];
     }
+    printf("%-12s %8zu %10.2f %8.3f %8.3f\n", "all", count, (double) ticks * ms,
+            count > 0 ? (double) ticks * ms / (double) count : 0.0, (double) max * ms);
+}
+
+
+/* Sample step of headless renders, uniform sampling costs the same
+ * for every curve of a given size */
+#define HEADLESS_SAMPLE_STEP 0.01f
+/* Space left around scenes that don't fit on the screen as they are */
+#define HEADLESS_MARGIN 8.0f
+
+/**
+ * Renderer, target surface and batcher of one thread of a headless
+ * render, every thread has its own so they never share SDL state
+ */
+typedef struct HeadlessWorker
+{
+    SDL_Surface *surface;
+    SDL_Renderer *renderer;
+    Batch *batch;
+#ifdef STROKE_GEOMETRY
+    Stroke stroke;
+#endif
+} HeadlessWorker;
+
+typedef struct Headless
+{
+    HeadlessWorker workers[POOL_MAX_THREADS];
+    size_t workers_count;
+    BatchPath path;
+    float line_width;
+    const char *out_dir;
+    char **files;
+    SDL_atomic_t failures;
+} Headless;
+
+/* Whether the name of file ends in extension, ignoring case */
+int has_extension(const char *file, const char *extension)
+{
+    const size_t length = strlen(file);
+    const size_t extension_length = strlen(extension);
+    return length >= extension_length
+        && SDL_strcasecmp(file + length - extension_length, extension) == 0;
 }
 
+/* Adds the curves of a .bez scene file or of a text file, see text_import */
+int load_curves(Scene *scene, const char *file)
+{
+    if (has_extension(file, ".bez"))
+        return scene_load(scene, file);
+    return text_import(scene, file);
+}
 
-void render_bezier_curve(SDL_Renderer *renderer, 
-        Vec2 *ps, Vec2 *xs, size_t n,
-        float s, Color color)
+/* out_dir/<name of file without its extension>.ppm */
+int headless_output_path(char *output, size_t size,
+        const char *out_dir, const char *file)
 {
-    for (float p = 0.0f+s; p <= 1.0f; p += s)
+    const char *name = file;
+    for (const char *c = file; *c != '\0'; c++)
     {
-        Vec2 begin = beziern_sample(ps, xs, n, p);
-        Vec2 end = beziern_sample(ps, xs, n, p+s);
+        if (*c == '/' || *c == '\\')
+            name = c + 1;
+    }
+    const char *dot = strrchr(name, '.');
+    const int length = dot != NULL && dot != name ? (int) (dot - name) : (int) strlen(name);
 
-        render_line(renderer, begin, end, color);
+    const int written = snprintf(output, size, "%s/%.*s.ppm", out_dir, length, name);
+    return written >= 0 && (size_t) written < size;
+}
+
+/**
+ * Writes an RGBA32 surface as a binary PPM, alpha dropped
+ * @return 1 on success, 0 on error, see SDL_GetError
+ */
+int write_ppm(SDL_Surface *surface, const char *file)
+{
+    Uint8 *row = malloc((size_t) surface->w * 3);
+    if (row == NULL)
+    {
+        SDL_OutOfMemory();
+        return 0;
+    }
+    SDL_RWops *rw = SDL_RWFromFile(file, "wb");
+    if (rw == NULL)
+    {
+        free(row);
+        return 0;
     }
 
+    char header[64];
+    const int header_length = snprintf(header, sizeof(header),
+            "P6\n%d %d\n255\n", surface->w, surface->h);
+    int ok = SDL_RWwrite(rw, header, 1, (size_t) header_length) == (size_t) header_length;
+
+    if (SDL_MUSTLOCK(surface))
+        check_sdl_code(SDL_LockSurface(surface));
+    for (int y = 0; ok && y < surface->h; y++)
+    {
+        const Uint8 *pixel = (const Uint8 *) surface->pixels + (size_t) y * surface->pitch;
+        for (int x = 0; x < surface->w; x++, pixel += 4)
+        {
+            row[x * 3 + 0] = pixel[0];
+            row[x * 3 + 1] = pixel[1];
+            row[x * 3 + 2] = pixel[2];
+        }
+        ok = SDL_RWwrite(rw, row, 3, (size_t) surface->w) == (size_t) surface->w;
+    }
+    if (SDL_MUSTLOCK(surface))
+        SDL_UnlockSurface(surface);
+
+    if (!ok)
+        SDL_SetError("couldn't write %s", file);
+    if (SDL_RWclose(rw) < 0)
+        ok = 0;
+    free(row);
+    return ok;
 }
 
-#define PS_CAPACITY 256
+/**
+ * Camera of a thumbnail: scenes within the logical screen are drawn as
+ * they are, anything else is fitted into it
+ */
+Camera headless_camera(Scene *scene)
+{
+    int found = 0;
+    Vec2 min = vec2(0.0f, 0.0f);
+    Vec2 max = vec2(0.0f, 0.0f);
+    for (size_t i = 0; i < scene->count; i++)
+    {
+        Curve *curve = scene->curves[i];
+        if (curve->count == 0)
+            continue;
+
+        Vec2 curve_min, curve_max;
+        curve_bounds(curve, &curve_min, &curve_max);
+        min = found ? vec2(fminf(min.x, curve_min.x), fminf(min.y, curve_min.y)) : curve_min;
+        max = found ? vec2(fmaxf(max.x, curve_max.x), fmaxf(max.y, curve_max.y)) : curve_max;
+        found = 1;
+    }
 
-Vec2 ps[PS_CAPACITY];
-Vec2 xs[PS_CAPACITY];
-int ps_count = 0;
-int ps_selected = -1;
+    if (!found || (min.x >= 0.0f && min.y >= 0.0f
+            && max.x <= SCREEN_WIDTH && max.y <= SCREEN_HEIGHT))
+        return camera_identity();
+    return camera_fit(min, max, SCREEN_WIDTH, SCREEN_HEIGHT, HEADLESS_MARGIN);
+}
 
-/** 
- * Take a position and check if there is marker there
- * @param pos : Vec2
- * @return index of the marker 
+/**
+ * Loads one input and renders its curves as thumbnails, without markers
+ * or control points. SVG paths come in as chains of cubics, so they are
+ * sampled as chains. Scenes reaching outside the screen are zoomed to
+ * fit, see headless_camera.
+ * @return 1 on success, 0 on error, see SDL_GetError
  */
-int ps_at(Vec2 pos)
+int headless_render(const Headless *headless, HeadlessWorker *worker, const char *file)
 {
-    const Vec2 ps_size = vec2(MARKER_SIZE, MARKER_SIZE);
-    for (int i = 0; i < ps_count; i++)
+    char output[4096];
+    if (!headless_output_path(output, sizeof(output), headless->out_dir, file))
     {
-        const Vec2 ps_begin = vec2_sub(ps[i], vec2_scale(ps_size, 0.5f));
-        const Vec2 ps_end = vec2_add(ps_begin, ps_size);
+        SDL_SetError("output path for %s is too long", file);
+        return 0;
+    }
+
+    /* Every thread renders files of its own, so curves sample inline */
+    Scene *scene = scene_create(headless->path, SCREEN_WIDTH, SCREEN_HEIGHT, MARKER_SIZE);
+    if (scene == NULL)
+    {
+        SDL_OutOfMemory();
+        return 0;
+    }
+
+    int ok = load_curves(scene, file);
+    if (ok)
+    {
+        SDL_Renderer *renderer = worker->renderer;
+        check_sdl_code(SDL_SetRenderDrawColor(renderer, HEX_COLOR(BACKGROUND_COLOR)));
+        check_sdl_code(SDL_RenderClear(renderer));
+        worker->batch->camera = headless_camera(scene);
 
-        if (pos.x >= ps_begin.x && pos.x <= ps_end.x
-            && pos.y >= ps_begin.y && pos.y <= ps_end.y)
+        const int piecewise = has_extension(file, ".svg");
+        for (size_t i = 0; i < scene->count; i++)
         {
-            return i;
+            Curve *curve = scene->curves[i];
+            if (curve->count == 0)
+                continue;
+
+            curve_update(curve, NULL, HEADLESS_SAMPLE_STEP, piecewise, 0, 0, ADAPTIVE_TOLERANCE);
+#ifdef STROKE_GEOMETRY
+            /* The samples versions of different curves may collide */
+            stroke_invalidate(&worker->stroke);
+            render_bezier_stroke(worker->batch, &worker->stroke, &curve->cache,
+                    headless->line_width, LINE_FRINGE, (Color){GREEN_COLOR});
+#else
+            render_bezier_curve(worker->batch, &curve->cache, (Color){GREEN_COLOR});
+#endif
         }
+        batch_flush(worker->batch);
+
+        /* Flushes whatever the renderer still has queued */
+        SDL_RenderPresent(renderer);
+        ok = write_ppm(worker->surface, output);
+    }
+
+    scene_destroy(scene);
+    return ok;
+}
+
+/* Renders files[begin, end) with the renderer of the worker */
+void headless_job(void *data, size_t begin, size_t end, size_t worker)
+{
+    Headless *headless = data;
+    for (size_t i = begin; i < end; i++)
+    {
+        if (!headless_render(headless, &headless->workers[worker], headless->files[i]))
+        {
+            fprintf(stderr, "Couldn't render %s: %s\n", headless->files[i], SDL_GetError());
+            SDL_AtomicAdd(&headless->failures, 1);
+        }
+    }
+}
+
+/**
+ * Renders every file into out_dir/<name>.ppm without a window. Each
+ * thread of the pool gets a software renderer on a surface of its own
+ * and takes files one at a time, so uneven files even out.
+ * @param files : char Paths of .bez, .csv or .svg files
+ * @return number of files that couldn't be rendered
+ */
+int render_headless(Pool *pool, BatchPath path, float line_width,
+        const char *out_dir, char **files, size_t count)
+{
+    Headless *headless = check_sdl_ptr(calloc(1, sizeof(Headless)));
+    headless->path = path;
+    headless->line_width = line_width;
+    headless->out_dir = out_dir;
+    headless->files = files;
+
+    headless->workers_count = pool_threads(pool);
+    for (size_t i = 0; i < headless->workers_count; i++)
+    {
+        HeadlessWorker *worker = &headless->workers[i];
+        worker->surface = check_sdl_ptr(SDL_CreateRGBSurfaceWithFormat(
+                    0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32));
+        worker->renderer = check_sdl_ptr(SDL_CreateSoftwareRenderer(worker->surface));
+#ifdef STROKE_GEOMETRY
+        check_sdl_code(SDL_SetRenderDrawBlendMode(worker->renderer, SDL_BLENDMODE_BLEND));
+#endif
+        worker->batch = check_sdl_ptr(calloc(1, sizeof(Batch)));
+        batch_init(worker->batch, worker->renderer);
     }
-    return -1;
+
+    pool_parallel_for(pool, count, 1, headless_job, headless);
+    const int failures = SDL_AtomicGet(&headless->failures);
+
+    for (size_t i = 0; i < headless->workers_count; i++)
+    {
+        HeadlessWorker *worker = &headless->workers[i];
+#ifdef STROKE_GEOMETRY
+        stroke_free(&worker->stroke);
+#endif
+        batch_destroy(worker->batch);
+        free(worker->batch);
+        SDL_DestroyRenderer(worker->renderer);
+        SDL_FreeSurface(worker->surface);
+    }
+    free(headless);
+    return failures;
+}
+
+
+void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [--vsync | --uncapped] [--profile-csv <file>] [--simd <path>] [--threads <n>]", program);
+#ifdef STROKE_GEOMETRY
+    fprintf(stderr, " [--line-width <w>]");
+#endif
+    fprintf(stderr, " [--scene <file>] [--import <file>] [--export <file>] [--record <file> | --replay <file>] [--render <dir> <file>...]\n");
+    fprintf(stderr, "    --vsync        wait for the display instead of sleeping\n");
+    fprintf(stderr, "    --uncapped     redraw every frame as fast as possible\n");
+    fprintf(stderr, "    --profile-csv  write the frame timings of every frame to <file>\n");
+    fprintf(stderr, "    --simd         force a sampling path:");
+    for (size_t i = 0; i < BATCH_PATHS_COUNT; i++)
+        fprintf(stderr, " %s", batch_path_names[i]);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "    --threads      threads sampling the curve, defaults to the CPU count\n");
+#ifdef STROKE_GEOMETRY
+    fprintf(stderr, "    --line-width   width of thick curves in logical pixels\n");
+#endif
+    fprintf(stderr, "    --scene        load the curves of <file> and save them there with S\n");
+    fprintf(stderr, "    --import       add the curves of a .csv point list or .svg file\n");
+    fprintf(stderr, "    --export       SVG file E writes the sampled curves to\n");
+    fprintf(stderr, "    --record       write the input events of the session to a journal <file>\n");
+    fprintf(stderr, "    --replay       run the events of a journal <file> as fast as possible and time them\n");
+    fprintf(stderr, "    --render       render every following file to <dir>/<name>.ppm without a window\n");
 }
 
+/* Parses a --simd argument, exits if the path isn't available here */
+BatchPath parse_batch_path(const char *program, const char *name)
+{
+    for (size_t i = 0; i < BATCH_PATHS_COUNT; i++)
+    {
+        if (strcmp(batch_path_names[i], name) == 0)
+        {
+            if (!batch_path_supported((BatchPath) i))
+            {
+                fprintf(stderr, "%s: %s is not supported on this machine\n", program, name);
+                exit(1);
+            }
+            return (BatchPath) i;
+        }
+    }
+    usage(program);
+    exit(1);
+}
 
 int main(int argc, char *argv[])
 {
+    FrameMode frame_mode = FRAME_CAPPED;
+    const char *profile_csv = NULL;
+    BatchPath path = batch_path_best();
+    int threads = 0;
+    const char *scene_file = NULL;
+    const char *import_file = NULL;
+    const char *export_file = EXPORT_FILE_DEFAULT;
+    const char *record_file = NULL;
+    const char *replay_file = NULL;
+    float line_width = LINE_WIDTH;
+    const char *render_dir = NULL;
+    char **render_files = NULL;
+    size_t render_count = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--vsync") == 0)
+            frame_mode = FRAME_VSYNC;
+        else if (strcmp(argv[i], "--uncapped") == 0)
+            frame_mode = FRAME_UNCAPPED;
+        else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc)
+            profile_csv = argv[++i];
+        else if (strcmp(argv[i], "--simd") == 0 && i + 1 < argc)
+            path = parse_batch_path(argv[0], argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+            scene_file = argv[++i];
+        else if (strcmp(argv[i], "--import") == 0 && i + 1 < argc)
+            import_file = argv[++i];
+        else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc)
+            export_file = argv[++i];
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            record_file = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replay_file = argv[++i];
+        else if (strcmp(argv[i], "--render") == 0 && i + 1 < argc)
+        {
+            render_dir = argv[++i];
+            render_files = argv + i + 1;
+            render_count = (size_t) (argc - i - 1);
+            break;
+        }
+#ifdef STROKE_GEOMETRY
+        else if (strcmp(argv[i], "--line-width") == 0 && i + 1 < argc)
+            line_width = strtof(argv[++i], NULL);
+#endif
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (record_file != NULL && replay_file != NULL)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (replay_file != NULL)
+        frame_mode = FRAME_REPLAY;
+
+    if (threads <= 0)
+        threads = SDL_GetCPUCount();
+
+    /* No video subsystem, so it runs where there is no display */
+    if (render_dir != NULL)
+    {
+        check_sdl_code(SDL_Init(0));
+        Pool * const pool = check_sdl_ptr(pool_create((size_t) threads - 1));
+        const int failures = render_headless(pool, path, line_width,
+                render_dir, render_files, render_count);
+        pool_destroy(pool);
+        SDL_Quit();
+        return failures > 0 ? 1 : 0;
+    }
+
     check_sdl_code(SDL_Init(SDL_INIT_VIDEO));
+    Pool * const pool = check_sdl_ptr(pool_create((size_t) threads - 1));
+    Scene * const scene = check_sdl_ptr(scene_create(path,
+                SCREEN_WIDTH, SCREEN_HEIGHT, MARKER_SIZE));
+    if (scene_file != NULL && !scene_load(scene, scene_file))
+        fprintf(stderr, "Couldn't load %s: %s\n", scene_file, SDL_GetError());
+    if (import_file != NULL && !text_import(scene, import_file))
+        fprintf(stderr, "Couldn't import %s: %s\n", import_file, SDL_GetError());
+    Batch * const batch = check_sdl_ptr(calloc(1, sizeof(Batch)));
+
+    Journal journal;
+    if (record_file != NULL && !journal_record_open(&journal, record_file))
+    {
+        fprintf(stderr, "Couldn't record to %s: %s\n", record_file, SDL_GetError());
+        record_file = NULL;
+    }
+    if (replay_file != NULL && !journal_replay_open(&journal, replay_file))
+    {
+        fprintf(stderr, "Couldn't replay %s: %s\n", replay_file, SDL_GetError());
+        return 1;
+    }
+    ReplayStats replay_stats;
+    replay_stats_init(&replay_stats);
 
     SDL_Window * const window = SDL_CreateWindow(
             "Bezier Curves",
@@ -270,19 +1219,88 @@ int main(int argc, char *argv[])
     SDL_Renderer * const renderer = 
         check_sdl_ptr(
                 SDL_CreateRenderer(
-                    window, -1, SDL_RENDERER_ACCELERATED));
+                    window, -1,
+                    SDL_RENDERER_ACCELERATED
+                    | (frame_mode == FRAME_VSYNC ? SDL_RENDERER_PRESENTVSYNC : 0)));
 
     check_sdl_code(SDL_RenderSetLogicalSize(renderer, SCREEN_WIDTH, SCREEN_HEIGHT));
+#ifdef STROKE_GEOMETRY
+    /* Untextured geometry blends with the draw blend mode */
+    check_sdl_code(SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND));
+    Strokes strokes = {0};
+#endif
+    batch_init(batch, renderer);
+    Fill fill;
+    check_sdl_code(fill_init(&fill, renderer, SCREEN_WIDTH, SCREEN_HEIGHT));
 
     float t = 0.0f;
     int markers = 1;
+    int adaptive = 0;
+    /* SVG paths come in as chains of cubics, like in headless_render */
+    int piecewise = import_file != NULL && has_extension(import_file, ".svg");
+    int even = 0;
+    int animating = 0;
+    int filled = 0;
+    int thick = 1;
     int quit = 0;
     float bezier_sample_step = 0.05f;
+    int redraw = 1;
+    int profiling = 0;
+    int selected = -1;
+    Camera camera = camera_identity();
+    int panning = 0;
+    /* Last position of the mouse in logical pixels */
+    Vec2 mouse = vec2(0.0f, 0.0f);
+
+    Profiler profiler;
+    profiler_init(&profiler, profile_csv);
+    float profile_title_timer = 0.0f;
+
+    FrameLimiter limiter;
+    frame_limiter_init(&limiter, frame_mode);
     while(!quit)
     {
+        if (frame_mode == FRAME_UNCAPPED || animating)
+            redraw = 1;
+
         SDL_Event event;
-        while(SDL_PollEvent(&event))
+        SDL_Keymod mod = KMOD_NONE;
+        int has_event;
+        if (replay_file != NULL)
+        {
+            /* Only closing the window interrupts a replay */
+            while (SDL_PollEvent(&event))
+            {
+                if (event.type == SDL_QUIT)
+                    quit = 1;
+            }
+
+            /* One event per frame, the first frame draws the scene
+             * the session started from */
+            has_event = !quit && profiler.frames > 0
+                && journal_replay_next(&journal, &event, &mod);
+            if (!has_event && profiler.frames > 0)
+                quit = 1;
+        }
+        else
+        {
+            /* Nothing to redraw: sleep until something happens */
+            has_event = redraw
+                ? SDL_PollEvent(&event)
+                : SDL_WaitEventTimeout(&event, IDLE_TIMEOUT_MS);
+        }
+        const int replay_kind = replay_file != NULL && has_event ? journal_kind(&event) : -1;
+        frame_limiter_begin(&limiter);
+        profile_begin(&profiler, PROFILE_FRAME);
+        profile_begin(&profiler, PROFILE_EVENTS);
+
+        for (; has_event; has_event = replay_file == NULL && SDL_PollEvent(&event))
         {
+            if (replay_file == NULL)
+                mod = SDL_GetModState();
+            if (record_file != NULL)
+                journal_record(&journal, &event, mod);
+
             switch(event.type)
             {
                 case SDL_QUIT:
@@ -294,6 +1312,87 @@ int main(int argc, char *argv[])
                     {
                         case SDLK_CAPSLOCK:
                             markers = !markers;
+                            redraw = 1;
+                            break;
+
+                        case SDLK_a:
+                            adaptive = !adaptive;
+                            redraw = 1;
+                            break;
+
+                        case SDLK_c:
+                            piecewise = !piecewise;
+                            redraw = 1;
+                            break;
+
+                        case SDLK_l:
+                            even = !even;
+                            redraw = 1;
+                            break;
+
+                        case SDLK_f:
+                            filled = !filled;
+                            redraw = 1;
+                            break;
+
+                        case SDLK_g:
+                            thick = !thick;
+                            redraw = 1;
+                            break;
+
+                        case SDLK_n:
+                            if (scene_active(scene)->count > 0 && scene_add(scene) == NULL)
+                                fprintf(stderr, "Out of memory, curve not added\n");
+                            redraw = 1;
+                            break;
+
+                        case SDLK_t:
+                            animating = !animating;
+                            redraw = 1;
+                            break;
+
+                        case SDLK_s:
+                            /* A replay must leave the files it starts
+                             * from as they were, so it writes nothing */
+                            if (replay_file != NULL)
+                                break;
+                            const char *file = scene_file != NULL ? scene_file : SCENE_FILE_DEFAULT;
+                            if (!scene_save(scene, file))
+                                fprintf(stderr, "Couldn't save %s: %s\n", file, SDL_GetError());
+                            break;
+
+                        case SDLK_e:
+                            if (replay_file != NULL)
+                                break;
+                            /* Curves off screen may not be sampled yet */
+                            for (size_t i = 0; i < scene->count; i++)
+                            {
+                                if (scene->curves[i]->count > 0)
+                                    curve_update(scene->curves[i], pool, bezier_sample_step,
+                                            piecewise, even, adaptive, adaptive_tolerance(renderer));
+                            }
+                            if (!text_export_svg(scene, export_file, SCREEN_WIDTH, SCREEN_HEIGHT))
+                                fprintf(stderr, "Couldn't export %s: %s\n", export_file, SDL_GetError());
+                            break;
+
+                        case SDLK_HOME:
+                            camera = camera_identity();
+                            redraw = 1;
+                            break;
+
+                        case SDLK_p:
+                            profiling = !profiling;
+                            if (!profiling)
+                                SDL_SetWindowTitle(window, "Bezier Curves");
+                            break;
+                    }
+                    break;
+
+                case SDL_WINDOWEVENT:
+                    if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED
+                        || event.window.event == SDL_WINDOWEVENT_EXPOSED)
+                    {
+                        redraw = 1;
                     }
                     break;
 
@@ -302,30 +1401,65 @@ int main(int argc, char *argv[])
                     switch (event.button.button)
                     {
                         case SDL_BUTTON_LEFT:
-                            ;const Vec2 mouse_pos = vec2(event.button.x, event.button.y);
-                            ps_selected = ps_at(mouse_pos);
+                            ;const Vec2 mouse_pos = camera_to_scene(&camera,
+                                    vec2(event.button.x, event.button.y));
+                            size_t hit_curve;
+                            selected = scene_point_at(scene, mouse_pos,
+                                    MARKER_SIZE * 0.5f / camera.zoom, &hit_curve);
+
+                            if (selected >= 0 && hit_curve != scene->active)
+                            {
+                                scene->active = hit_curve;
+                                redraw = 1;
+                            }
+                            else if (selected < 0)
+                            {
+                                if (curve_push(scene_active(scene), mouse_pos) < 0)
+                                    fprintf(stderr, "Out of memory, point not added\n");
+                                redraw = 1;
+                            }
 
-                            if (ps_selected < 0 && ps_count < PS_CAPACITY)
-                                ps[ps_count++] = mouse_pos;
+                            break;
 
+                        case SDL_BUTTON_RIGHT:
+                            panning = 1;
                             break;
                     }
                     break;
                 case SDL_MOUSEMOTION:
-                    ;Vec2 mouse_pos = vec2(event.motion.x, event.motion.y);
-                    if (ps_selected >= 0)
+                    ;const Vec2 motion_pos = vec2(event.motion.x, event.motion.y);
+                    if (panning)
+                    {
+                        const Vec2 delta = vec2_sub(motion_pos, mouse);
+                        camera.offset = vec2_sub(camera.offset, vec2_scale(delta, 1.0f / camera.zoom));
+                        redraw = 1;
+                    }
+                    mouse = motion_pos;
+                    if (selected >= 0)
                     {
-                        ps[ps_selected] = mouse_pos;
+                        curve_move(scene_active(scene), selected, camera_to_scene(&camera, motion_pos));
+                        redraw = 1;
                     }
                     break;
                 case SDL_MOUSEBUTTONUP:
                     if (event.button.button == SDL_BUTTON_LEFT)
                     {
-                        ps_selected = -1;
+                        selected = -1;
+                        if (curve_settle(scene_active(scene)))
+                            redraw = 1;
+                    }
+                    else if (event.button.button == SDL_BUTTON_RIGHT)
+                    {
+                        panning = 0;
                     }
                     break;
                 case SDL_MOUSEWHEEL:
-                    if (event.wheel.y > 0)
+                    if (mod & KMOD_CTRL)
+                    {
+                        camera_zoom_at(&camera, mouse,
+                                event.wheel.y > 0 ? CAMERA_ZOOM_STEP : 1.0f / CAMERA_ZOOM_STEP);
+                    }
+                    else if (event.wheel.y > 0)
                     {
                         bezier_sample_step = fmin(bezier_sample_step + 0.001f, 1.0f);
                     }
@@ -333,42 +1467,163 @@ int main(int argc, char *argv[])
                     {
                         bezier_sample_step = fmax(bezier_sample_step - 0.001f, 0.001f);
                     }
+                    redraw = 1;
                     break;
             }
         }
+        profile_end(&profiler, PROFILE_EVENTS);
+
+        if (redraw)
+        {
+            check_sdl_code(SDL_SetRenderDrawColor(
+                    renderer,
+                    HEX_COLOR(BACKGROUND_COLOR)));
+
+            check_sdl_code(SDL_RenderClear(renderer));
+
+
+            /* Curves outside the logical viewport are neither sampled
+             * nor submitted, markers may stick out by half their size */
+            const float margin = MARKER_SIZE * 0.5f;
+            const Vec2 view_min = camera_to_scene(&camera, vec2(-margin, -margin));
+            const Vec2 view_max = camera_to_scene(&camera,
+                    vec2(SCREEN_WIDTH + margin, SCREEN_HEIGHT + margin));
+            batch->camera = camera;
+
+            /* The adaptive tolerance follows the zoom in powers of 2,
+             * so zooming within one keeps the samples like the levels
+             * of detail of the uniform mode do */
+            float scale_x, scale_y;
+            SDL_RenderGetScale(renderer, &scale_x, &scale_y);
+            const float lod_zoom = exp2f(floorf(log2f(camera.zoom)));
+            const float tolerance = ADAPTIVE_TOLERANCE / (fmaxf(scale_x, scale_y) * lod_zoom);
+
+            profile_begin(&profiler, PROFILE_SAMPLING);
+            size_t samples = 0;
+            for (size_t i = 0; i < scene->count; i++)
+            {
+                Curve *curve = scene->curves[i];
+                if (curve_intersects(curve, view_min, view_max))
+                {
+                    const int level = curve_lod_level(curve, bezier_sample_step,
+                            piecewise, adaptive, camera.zoom);
+                    samples += curve_update_lod(curve, pool, level, bezier_sample_step,
+                            piecewise, even, adaptive, tolerance);
+                }
+            }
+            profile_count_samples(&profiler, samples);
+            profile_end(&profiler, PROFILE_SAMPLING);
 
-        check_sdl_code(SDL_SetRenderDrawColor(
-                renderer,
-                HEX_COLOR(BACKGROUND_COLOR)));
+            profile_begin(&profiler, PROFILE_SUBMIT);
+            if (filled)
+            {
+                /* Rasterized again only when a visible curve changed.
+                 * Only closed curves, the line closing an open one
+                 * would cut a wedge out of the drawing. */
+                fill_begin(&fill, camera.offset, camera.zoom);
+                for (size_t i = 0; i < scene->count; i++)
+                {
+                    Curve *curve = scene->curves[i];
+                    if (!curve_intersects(curve, view_min, view_max)
+                        || !curve_closed(curve, MARKER_SIZE * 0.5f / camera.zoom))
+                        continue;
+
+                    const SampleCache *cache = curve_lod_cache(curve, curve_lod_level(curve,
+                                bezier_sample_step, piecewise, adaptive, camera.zoom));
+
+                    SDL_Color color = color_sdl(i == scene->active
+                            ? (Color){GREEN_COLOR}
+                            : (Color){BLUE_COLOR});
+                    color.a = FILL_ALPHA;
+                    fill_shape(&fill, cache->samples, cache->count + 1,
+                            cache->version, color);
+                }
+                check_sdl_code(fill_end(&fill));
+                check_sdl_code(fill_draw(&fill, renderer));
+            }
 
-        check_sdl_code(SDL_RenderClear(renderer));
+            for (size_t i = 0; i < scene->count; i++)
+            {
+                Curve *curve = scene->curves[i];
+                if (!curve_intersects(curve, view_min, view_max))
+                    continue;
+
+                const SampleCache *cache = curve_lod_cache(curve, curve_lod_level(curve,
+                            bezier_sample_step, piecewise, adaptive, camera.zoom));
+                const Color color = i == scene->active
+                    ? (Color){GREEN_COLOR}
+                    : (Color){BLUE_COLOR};
+                if (markers)
+                    render_bezier_markers(batch, cache, color);
+#ifdef STROKE_GEOMETRY
+                else if (thick)
+                    render_bezier_stroke(batch, strokes_at(&strokes, i), cache,
+                            line_width, LINE_FRINGE / fmaxf(scale_x, scale_y), color);
+#endif
+                else
+                    render_bezier_curve(batch, cache, color);
+            }
 
-        
-        if (ps_count >= 1)
-        {
-            if (markers)
-                render_bezier_markers(renderer, ps, xs, ps_count, bezier_sample_step, (Color){GREEN_COLOR});
-            else
-                render_bezier_curve(renderer, ps, xs, ps_count, bezier_sample_step, (Color){GREEN_COLOR});
-        }
+            const Curve *active = scene_active(scene);
+            for (size_t i = 0; i < active->count; i++)
+            {
+                batch_marker(batch, active->ps[i], (Color){RED_COLOR});
+            }
+            batch_line_strip(batch, active->ps, active->count, (Color){RED_COLOR});
+            if (animating && active->count > 0)
+                render_bezier_animation(batch, scene_active(scene), pool, piecewise, t);
 
-        for (int i = 0; ps_count > 0 && i < ps_count; i++)
-        {
-            render_marker(renderer, ps[i], (Color){RED_COLOR});
-            if ( i < ps_count - 1)
+            batch_flush(batch);
+            profile_end(&profiler, PROFILE_SUBMIT);
+
+            profile_begin(&profiler, PROFILE_PRESENT);
+            SDL_RenderPresent(renderer);
+            profile_end(&profiler, PROFILE_PRESENT);
+            redraw = 0;
+
+            profile_end(&profiler, PROFILE_FRAME);
+            profiler_frame_end(&profiler);
+            if (profiling && profile_title_timer >= PROFILE_TITLE_INTERVAL_SEC)
             {
-                render_line(renderer, ps[i], ps[i+1], (Color){RED_COLOR});
+                profiler_show(&profiler, window);
+                profile_title_timer = 0.0f;
             }
-        }
 
-        SDL_RenderPresent(renderer);
+            frame_limiter_end(&limiter);
+        }
+        else
+        {
+            profile_end(&profiler, PROFILE_FRAME);
+        }
+        if (replay_kind >= 0)
+        {
+            replay_stats_add(&replay_stats, (JournalKind) replay_kind,
+                    SDL_GetPerformanceCounter() - limiter.frame_begin);
+        }
 
-        SDL_Delay(DELTA_TIME_MS);
-        t += DELTA_TIME_SEC;
+        const float dt = frame_limiter_tick(&limiter);
+        t += dt;
+        profile_title_timer += dt;
 
     }
 
 
+    profiler_close(&profiler);
+    if (record_file != NULL && !journal_record_close(&journal, record_file))
+        fprintf(stderr, "Couldn't record to %s: %s\n", record_file, SDL_GetError());
+    if (replay_file != NULL)
+    {
+        replay_stats_print(&replay_stats, &journal, replay_file, profiler.frames);
+        journal_replay_close(&journal);
+    }
+#ifdef STROKE_GEOMETRY
+    strokes_free(&strokes);
+#endif
+    fill_free(&fill);
+    batch_destroy(batch);
+    free(batch);
+    scene_destroy(scene);
+    pool_destroy(pool);
 
     SDL_Quit();
 
@@ -0,0 +1,226 @@
+/* Worker pool for data parallel loops, see pool.h */
+
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#include "pool.h"
+
+struct Pool
+{
+    SDL_Thread *threads[POOL_MAX_THREADS];
+    size_t workers;
+
+    SDL_mutex *mutex;
+    SDL_cond *work_ready;
+    SDL_cond *work_done;
+    unsigned generation;
+    size_t pending;
+    int quit;
+
+    /* The loop currently running */
+    PoolJob job;
+    void *data;
+    size_t count;
+    size_t chunk;
+    SDL_atomic_t next;
+
+    /* Scratch of every thread, indexed by worker */
+    void *scratch[POOL_MAX_THREADS];
+    size_t scratch_size;
+};
+
+typedef struct PoolWorker
+{
+    Pool *pool;
+    size_t index;
+} PoolWorker;
+
+/* Grabs chunks of the current loop until there are none left */
+static void pool_run_chunks(Pool *pool, size_t worker)
+{
+    for (;;)
+    {
+        const size_t begin = (size_t) SDL_AtomicAdd(&pool->next, (int) pool->chunk);
+        if (begin >= pool->count)
+            break;
+
+        const size_t end = begin + pool->chunk < pool->count
+            ? begin + pool->chunk
+            : pool->count;
+        pool->job(pool->data, begin, end, worker);
+    }
+}
+
+static int pool_worker_main(void *arg)
+{
+    PoolWorker worker = *(PoolWorker *) arg;
+    free(arg);
+
+    Pool *pool = worker.pool;
+    unsigned seen = 0;
+
+    SDL_LockMutex(pool->mutex);
+    for (;;)
+    {
+        while (!pool->quit && pool->generation == seen)
+            SDL_CondWait(pool->work_ready, pool->mutex);
+        if (pool->quit)
+            break;
+        seen = pool->generation;
+        SDL_UnlockMutex(pool->mutex);
+
+        pool_run_chunks(pool, worker.index);
+
+        SDL_LockMutex(pool->mutex);
+        if (--pool->pending == 0)
+            SDL_CondSignal(pool->work_done);
+    }
+    SDL_UnlockMutex(pool->mutex);
+
+    return 0;
+}
+
+/**
+ * Starts up to workers helper threads, fewer if POOL_MAX_THREADS
+ * is reached or SDL fails to create them
+ * @param workers : size_t Number of threads besides the caller
+ * @return the pool or NULL when out of memory
+ */
+Pool *pool_create(size_t workers)
+{
+    Pool *pool = calloc(1, sizeof(Pool));
+    if (pool == NULL)
+        return NULL;
+
+    pool->mutex = SDL_CreateMutex();
+    pool->work_ready = SDL_CreateCond();
+    pool->work_done = SDL_CreateCond();
+    if (pool->mutex == NULL || pool->work_ready == NULL || pool->work_done == NULL)
+    {
+        pool_destroy(pool);
+        return NULL;
+    }
+
+    if (workers > POOL_MAX_THREADS - 1)
+        workers = POOL_MAX_THREADS - 1;
+
+    for (size_t i = 0; i < workers; i++)
+    {
+        PoolWorker *worker = malloc(sizeof(PoolWorker));
+        if (worker == NULL)
+            break;
+        worker->pool = pool;
+        worker->index = i + 1;
+
+        pool->threads[i] = SDL_CreateThread(pool_worker_main, "bezier worker", worker);
+        if (pool->threads[i] == NULL)
+        {
+            free(worker);
+            break;
+        }
+        pool->workers++;
+    }
+
+    return pool;
+}
+
+void pool_destroy(Pool *pool)
+{
+    if (pool == NULL)
+        return;
+
+    if (pool->mutex != NULL)
+    {
+        SDL_LockMutex(pool->mutex);
+        pool->quit = 1;
+        SDL_CondBroadcast(pool->work_ready);
+        SDL_UnlockMutex(pool->mutex);
+    }
+
+    for (size_t i = 0; i < pool->workers; i++)
+        SDL_WaitThread(pool->threads[i], NULL);
+
+    SDL_DestroyCond(pool->work_done);
+    SDL_DestroyCond(pool->work_ready);
+    SDL_DestroyMutex(pool->mutex);
+    for (size_t i = 0; i < POOL_MAX_THREADS; i++)
+        free(pool->scratch[i]);
+    free(pool);
+}
+
+size_t pool_threads(const Pool *pool)
+{
+    return pool == NULL ? 1 : pool->workers + 1;
+}
+
+/**
+ * Runs job over [0, count) in chunks of chunk indices on all threads of
+ * the pool and returns once every chunk is done. The caller is worker 0.
+ * A NULL pool runs the whole range inline.
+ */
+void pool_parallel_for(Pool *pool, size_t count, size_t chunk,
+        PoolJob job, void *data)
+{
+    if (count == 0)
+        return;
+
+    if (pool == NULL || pool->workers == 0 || count <= chunk)
+    {
+        job(data, 0, count, 0);
+        return;
+    }
+
+    SDL_LockMutex(pool->mutex);
+    pool->job = job;
+    pool->data = data;
+    pool->count = count;
+    pool->chunk = chunk > 0 ? chunk : 1;
+    SDL_AtomicSet(&pool->next, 0);
+    pool->pending = pool->workers;
+    pool->generation++;
+    SDL_CondBroadcast(pool->work_ready);
+    SDL_UnlockMutex(pool->mutex);
+
+    pool_run_chunks(pool, 0);
+
+    SDL_LockMutex(pool->mutex);
+    while (pool->pending > 0)
+        SDL_CondWait(pool->work_done, pool->mutex);
+    SDL_UnlockMutex(pool->mutex);
+}
+
+/**
+ * Makes the scratch of every thread at least size bytes, at least
+ * doubling it so a slightly bigger loop doesn't grow it again. Only
+ * called between loops, by the thread that runs them.
+ * @return 1 on success, 0 when out of memory, the scratch may be
+ * smaller than size for some threads then
+ */
+int pool_reserve_scratch(Pool *pool, size_t size)
+{
+    if (size <= pool->scratch_size)
+        return 1;
+    if (size < pool->scratch_size * 2)
+        size = pool->scratch_size * 2;
+
+    for (size_t i = 0; i < pool_threads(pool); i++)
+    {
+        void *scratch = realloc(pool->scratch[i], size);
+        if (scratch == NULL)
+            return 0;
+        pool->scratch[i] = scratch;
+    }
+    pool->scratch_size = size;
+    return 1;
+}
+
+/**
+ * Scratch of a thread of the loop running on the pool, see
+ * pool_reserve_scratch
+ * @param worker : size_t Index the job was called with
+ */
+void *pool_scratch(const Pool *pool, size_t worker)
+{
+    return pool->scratch[worker];
+}
@@ -0,0 +1,40 @@
+/* Worker pool for data parallel loops
+ *
+ * A fixed set of SDL threads that split the index range of a
+ * parallel for into chunks. The calling thread works on chunks too, so
+ * a pool with 0 workers simply runs the loop inline.
+ *
+ * Every thread also owns a scratch buffer, shared by whatever runs on
+ * the pool, so loops that need scratch don't keep one per thread each.
+ */
+
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stddef.h>
+
+/* Upper bound of threads taking part in a loop, including the caller */
+#define POOL_MAX_THREADS 32
+
+/**
+ * Body of a parallel for, called for [begin, end) chunks of the range.
+ * worker is in [0, pool_threads()) and unique among the concurrently
+ * running calls, so it can index per thread scratch buffers.
+ */
+typedef void (*PoolJob)(void *data, size_t begin, size_t end, size_t worker);
+
+typedef struct Pool Pool;
+
+Pool *pool_create(size_t workers);
+void pool_destroy(Pool *pool);
+
+/* Number of threads taking part in a loop, including the caller */
+size_t pool_threads(const Pool *pool);
+
+void pool_parallel_for(Pool *pool, size_t count, size_t chunk,
+        PoolJob job, void *data);
+
+int pool_reserve_scratch(Pool *pool, size_t size);
+void *pool_scratch(const Pool *pool, size_t worker);
+
+#endif // POOL_H_
@@ -0,0 +1,255 @@
+/* Scene of independent curves, see scene.h */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "scene.h"
+
+/* Points byte swapped at a time when saving on big endian hosts */
+#define SCENE_FILE_CHUNK 4096
+
+/**
+ * Creates a scene with one empty, active curve
+ * @param path : BatchPath see curve_create
+ * @param width, height, cell_size : float Hit test grid of every curve
+ * @return the scene or NULL when out of memory
+ */
+Scene *scene_create(BatchPath path, float width, float height, float cell_size)
+{
+    Scene *scene = calloc(1, sizeof(Scene));
+    if (scene == NULL)
+        return NULL;
+
+    scene->path = path;
+    scene->width = width;
+    scene->height = height;
+    scene->cell_size = cell_size;
+
+    if (scene_add(scene) == NULL)
+    {
+        scene_destroy(scene);
+        return NULL;
+    }
+    return scene;
+}
+
+void scene_destroy(Scene *scene)
+{
+    if (scene == NULL)
+        return;
+
+    for (size_t i = 0; i < scene->count; i++)
+        curve_destroy(scene->curves[i]);
+    free(scene->curves);
+    free(scene);
+}
+
+/**
+ * Appends an empty curve and makes it the active one
+ * @return the curve or NULL when out of memory
+ */
+Curve *scene_add(Scene *scene)
+{
+    if (scene->count == scene->capacity)
+    {
+        const size_t capacity = scene->capacity > 0 ? scene->capacity * 2 : 16;
+        Curve **curves = realloc(scene->curves, capacity * sizeof(Curve *));
+        if (curves == NULL)
+            return NULL;
+        scene->curves = curves;
+        scene->capacity = capacity;
+    }
+
+    Curve *curve = curve_create(scene->path, scene->width, scene->height, scene->cell_size);
+    if (curve == NULL)
+        return NULL;
+
+    scene->active = scene->count;
+    scene->curves[scene->count++] = curve;
+    return curve;
+}
+
+Curve *scene_active(const Scene *scene)
+{
+    return scene->curves[scene->active];
+}
+
+/**
+ * Curve for points that should start a curve of their own: the active
+ * curve while it's still empty, a new active curve otherwise
+ * @return the curve or NULL when out of memory
+ */
+Curve *scene_empty_curve(Scene *scene)
+{
+    Curve *curve = scene_active(scene);
+    return curve->count == 0 ? curve : scene_add(scene);
+}
+
+/**
+ * Take a position and check if there is a control point of any curve
+ * there. The active curve wins, then the curve added last, which is
+ * the one drawn on top.
+ * @param pos : Vec2
+ * @param half_size : float Half the side of the hit box around every point
+ * @param curve : size_t Set to the index of the curve that was hit
+ * @return index of the point in that curve, -1 if none
+ */
+int scene_point_at(Scene *scene, Vec2 pos, float half_size, size_t *curve)
+{
+    const Vec2 box = vec2(half_size, half_size);
+    const Vec2 min = vec2_sub(pos, box);
+    const Vec2 max = vec2_add(pos, box);
+
+    int point = curve_point_at(scene_active(scene), pos, half_size);
+    if (point >= 0)
+    {
+        *curve = scene->active;
+        return point;
+    }
+
+    for (size_t i = scene->count; i-- > 0;)
+    {
+        if (i == scene->active || !curve_intersects(scene->curves[i], min, max))
+            continue;
+
+        point = curve_point_at(scene->curves[i], pos, half_size);
+        if (point >= 0)
+        {
+            *curve = i;
+            return point;
+        }
+    }
+    return -1;
+}
+
+/* Reads count points straight into the room reserved after the last
+ * point of curve, in one read, swapped in place on big endian hosts */
+static int scene_read_points(SDL_RWops *rw, Curve *curve, size_t count)
+{
+    Vec2 *points = curve->ps + curve->count;
+    if (count > 0 && SDL_RWread(rw, points, sizeof(Vec2), count) != count)
+    {
+        SDL_SetError("the scene file is truncated");
+        return 0;
+    }
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    for (size_t i = 0; i < count; i++)
+    {
+        points[i].x = SDL_SwapFloatLE(points[i].x);
+        points[i].y = SDL_SwapFloatLE(points[i].y);
+    }
+#endif
+    curve_extend(curve, count);
+    return 1;
+}
+
+/* Reads the header and every curve of a scene file, see scene_load */
+static int scene_read(SDL_RWops *rw, Scene *scene, const char *file)
+{
+    char magic[4];
+    if (SDL_RWread(rw, magic, sizeof(magic), 1) != 1
+        || memcmp(magic, SCENE_FILE_MAGIC, sizeof(magic)) != 0)
+    {
+        SDL_SetError("%s is not a scene file", file);
+        return 0;
+    }
+    if (SDL_ReadLE32(rw) != SCENE_FILE_VERSION)
+    {
+        SDL_SetError("%s has an unsupported version", file);
+        return 0;
+    }
+
+    const Uint64 curves = SDL_ReadLE64(rw);
+    for (Uint64 i = 0; i < curves; i++)
+    {
+        const Uint64 count = SDL_ReadLE64(rw);
+
+        /* Reject counts the rest of the file can't hold before
+         * reserving room for them */
+        const Sint64 left = SDL_RWsize(rw) - SDL_RWtell(rw);
+        if (left < 0 || count > (Uint64) left / sizeof(Vec2))
+        {
+            SDL_SetError("%s is truncated", file);
+            return 0;
+        }
+
+        Curve *curve = scene_empty_curve(scene);
+        if (curve == NULL || !curve_reserve(curve, curve->count + count))
+        {
+            SDL_OutOfMemory();
+            return 0;
+        }
+        if (!scene_read_points(rw, curve, (size_t) count))
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * Adds the curves of a scene file to the scene, the first one goes into
+ * the active curve if that is still empty. Every curve is reserved at
+ * its full size up front and the points are read straight into it.
+ * Curves read before an error stay in the scene.
+ * @param file : const char Path of the scene file
+ * @return 1 on success, 0 on error, see SDL_GetError
+ */
+int scene_load(Scene *scene, const char *file)
+{
+    SDL_RWops *rw = SDL_RWFromFile(file, "rb");
+    if (rw == NULL)
+        return 0;
+
+    const int ok = scene_read(rw, scene, file);
+    SDL_RWclose(rw);
+    return ok;
+}
+
+/**
+ * Writes every curve of the scene to a scene file, the points of a
+ * curve in one write on little endian hosts
+ * @param file : const char Path of the scene file, replaced if it exists
+ * @return 1 on success, 0 on error, see SDL_GetError
+ */
+int scene_save(const Scene *scene, const char *file)
+{
+    SDL_RWops *rw = SDL_RWFromFile(file, "wb");
+    if (rw == NULL)
+        return 0;
+
+    int ok = SDL_RWwrite(rw, SCENE_FILE_MAGIC, 4, 1) == 1
+        && SDL_WriteLE32(rw, SCENE_FILE_VERSION) == 1
+        && SDL_WriteLE64(rw, scene->count) == 1;
+
+    for (size_t i = 0; ok && i < scene->count; i++)
+    {
+        const Curve *curve = scene->curves[i];
+        ok = SDL_WriteLE64(rw, curve->count) == 1;
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+        Vec2 chunk[SCENE_FILE_CHUNK];
+        for (size_t j = 0; ok && j < curve->count; j += SCENE_FILE_CHUNK)
+        {
+            const size_t n = curve->count - j < SCENE_FILE_CHUNK
+                ? curve->count - j
+                : SCENE_FILE_CHUNK;
+            for (size_t k = 0; k < n; k++)
+            {
+                chunk[k].x = SDL_SwapFloatLE(curve->ps[j + k].x);
+                chunk[k].y = SDL_SwapFloatLE(curve->ps[j + k].y);
+            }
+            ok = SDL_RWwrite(rw, chunk, sizeof(Vec2), n) == n;
+        }
+#else
+        if (ok && curve->count > 0)
+            ok = SDL_RWwrite(rw, curve->ps, sizeof(Vec2), curve->count) == curve->count;
+#endif
+    }
+
+    /* Closing flushes, so it can fail too */
+    if (SDL_RWclose(rw) < 0)
+        ok = 0;
+    return ok;
+}
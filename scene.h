@@ -0,0 +1,54 @@
+/* Scene of independent curves
+ *
+ * Every curve keeps its own bounds, dirty flag and samples, so a frame
+ * only resamples the curves that changed. One curve at a time is
+ * active: that is the one clicks add points to.
+ *
+ * Scenes are stored in a binary file, all values little endian:
+ *
+ *     char   magic[4]    "BEZS"
+ *     uint32 version     SCENE_FILE_VERSION
+ *     uint64 curves
+ *     then for every curve
+ *     uint64 count
+ *     float  points[count][2]    x, y
+ *
+ * so the points are 8 byte aligned, packed Vec2 arrays that are read
+ * straight into the curves without any parsing.
+ */
+
+#ifndef SCENE_H_
+#define SCENE_H_
+
+#include "curve.h"
+
+#define SCENE_FILE_MAGIC "BEZS"
+#define SCENE_FILE_VERSION 1
+
+typedef struct Scene
+{
+    Curve **curves;
+    size_t count;
+    size_t capacity;
+    size_t active;
+
+    /* Settings every new curve is created with */
+    BatchPath path;
+    float width;
+    float height;
+    float cell_size;
+} Scene;
+
+Scene *scene_create(BatchPath path, float width, float height, float cell_size);
+void scene_destroy(Scene *scene);
+
+Curve *scene_add(Scene *scene);
+Curve *scene_active(const Scene *scene);
+Curve *scene_empty_curve(Scene *scene);
+
+int scene_point_at(Scene *scene, Vec2 pos, float half_size, size_t *curve);
+
+int scene_load(Scene *scene, const char *file);
+int scene_save(const Scene *scene, const char *file);
+
+#endif // SCENE_H_
@@ -0,0 +1,236 @@
+/* Thick, anti-aliased polylines for SDL_RenderGeometry, see stroke.h */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "stroke.h"
+
+#ifdef STROKE_GEOMETRY
+
+/* Every point gets 4 vertices across the line: outer fringe, core,
+ * core, outer fringe. Every segment 3 quads between them. */
+#define STROKE_POINT_VERTICES 4
+#define STROKE_SEGMENT_INDICES 18
+
+static int stroke_reserve(Stroke *stroke, size_t count)
+{
+    if (count <= stroke->capacity)
+        return 1;
+
+    size_t capacity = stroke->capacity > 0 ? stroke->capacity : 64;
+    while (capacity < count)
+        capacity *= 2;
+
+    SDL_Vertex *vertices = realloc(stroke->vertices,
+            capacity * STROKE_POINT_VERTICES * sizeof(SDL_Vertex));
+    if (vertices == NULL)
+        return 0;
+    stroke->vertices = vertices;
+
+    int *indices = realloc(stroke->indices,
+            capacity * STROKE_SEGMENT_INDICES * sizeof(int));
+    if (indices == NULL)
+        return 0;
+    stroke->indices = indices;
+
+    stroke->capacity = capacity;
+    return 1;
+}
+
+static Vec2 stroke_direction(Vec2 a, Vec2 b)
+{
+    const Vec2 d = vec2_sub(b, a);
+    const float len = sqrtf(d.x * d.x + d.y * d.y);
+    return vec2_scale(d, 1.0f / len);
+}
+
+static void stroke_vertex(SDL_Vertex *vertex, Vec2 pos, SDL_Color color)
+{
+    vertex->position = (SDL_FPoint) {pos.x, pos.y};
+    vertex->color = color;
+    vertex->tex_coord = (SDL_FPoint) {0.0f, 0.0f};
+}
+
+/* Appends the vertices of a point with the given unit normal, the
+ * offsets are scaled by the miter so joins keep their width */
+static void stroke_point(Stroke *stroke, Vec2 pos, Vec2 normal, float miter,
+        float width, float fringe, SDL_Color color)
+{
+    const float core = width * 0.5f * miter;
+    const float outer = (width * 0.5f + fringe) * miter;
+    SDL_Color clear = color;
+    clear.a = 0;
+
+    SDL_Vertex *v = stroke->vertices + stroke->vertices_count;
+    stroke_vertex(&v[0], vec2_add(pos, vec2_scale(normal, -outer)), clear);
+    stroke_vertex(&v[1], vec2_add(pos, vec2_scale(normal, -core)), color);
+    stroke_vertex(&v[2], vec2_add(pos, vec2_scale(normal, core)), color);
+    stroke_vertex(&v[3], vec2_add(pos, vec2_scale(normal, outer)), clear);
+    stroke->vertices_count += STROKE_POINT_VERTICES;
+}
+
+/* Connects the last two points with 3 quads */
+static void stroke_segment(Stroke *stroke)
+{
+    const int b = stroke->vertices_count - STROKE_POINT_VERTICES;
+    const int a = b - STROKE_POINT_VERTICES;
+    int *index = stroke->indices + stroke->indices_count;
+    for (int k = 0; k < STROKE_POINT_VERTICES - 1; k++)
+    {
+        *index++ = a + k;
+        *index++ = a + k + 1;
+        *index++ = b + k + 1;
+        *index++ = a + k;
+        *index++ = b + k + 1;
+        *index++ = b + k;
+    }
+    stroke->indices_count += STROKE_SEGMENT_INDICES;
+}
+
+/**
+ * Rebuilds the mesh if the polyline or the style changed since the
+ * last call, otherwise keeps the mesh of the previous frames
+ * @param stroke : Stroke pointer, zero initialized the first time
+ * @param version : unsigned Changes whenever the points change
+ * @param points : Vec2 Polyline
+ * @param count : size_t Number of points
+ * @param offset, zoom : Vec2, float The points are drawn at (p - offset) * zoom
+ * @param width : float Width of the solid core
+ * @param fringe : float Width of the fade out on both sides
+ * @param color : SDL_Color
+ * @return 1 on success, 0 when out of memory
+ */
+int stroke_update(Stroke *stroke, unsigned version,
+        const Vec2 *points, size_t count, Vec2 offset, float zoom,
+        float width, float fringe, SDL_Color color)
+{
+    if (stroke->built && stroke->version == version
+        && stroke->offset.x == offset.x && stroke->offset.y == offset.y
+        && stroke->zoom == zoom
+        && stroke->width == width && stroke->fringe == fringe
+        && stroke->color.r == color.r && stroke->color.g == color.g
+        && stroke->color.b == color.b && stroke->color.a == color.a)
+        return 1;
+
+    if (!stroke_reserve(stroke, count))
+        return 0;
+
+    stroke->built = 1;
+    stroke->version = version;
+    stroke->offset = offset;
+    stroke->zoom = zoom;
+    stroke->width = width;
+    stroke->fringe = fringe;
+    stroke->color = color;
+    stroke->vertices_count = 0;
+    stroke->indices_count = 0;
+
+    /* Repeated points have no direction, skip them */
+    size_t last = 0;
+    Vec2 direction = vec2(1.0f, 0.0f);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i > 0 && points[i].x == points[last].x && points[i].y == points[last].y)
+            continue;
+
+        size_t next = i + 1;
+        while (next < count && points[next].x == points[i].x && points[next].y == points[i].y)
+            next++;
+
+        Vec2 normal;
+        float miter = 1.0f;
+        const int first = stroke->vertices_count == 0;
+        if (next < count)
+        {
+            const Vec2 outgoing = stroke_direction(points[i], points[next]);
+            const Vec2 sum = vec2_add(direction, outgoing);
+            /* A full turn back has no average direction, keep the
+             * normal of the incoming segment */
+            const int reverse = fabsf(sum.x) + fabsf(sum.y) < 1e-4f;
+            const Vec2 tangent = first
+                ? outgoing
+                : (reverse ? direction : stroke_direction(vec2(0.0f, 0.0f), sum));
+            normal = vec2(-tangent.y, tangent.x);
+            if (!first && !reverse)
+            {
+                /* The offsets along the averaged normal have to grow by
+                 * 1 / cos of half the angle between the segments */
+                const float cos_half = normal.x * -direction.y + normal.y * direction.x;
+                miter = cos_half > 1.0f / STROKE_MITER_LIMIT
+                    ? 1.0f / cos_half
+                    : STROKE_MITER_LIMIT;
+            }
+            direction = outgoing;
+        }
+        else
+        {
+            normal = vec2(-direction.y, direction.x);
+        }
+
+        /* The directions don't change with the view, only the points */
+        const Vec2 pos = vec2_scale(vec2_sub(points[i], offset), zoom);
+        stroke_point(stroke, pos, normal, miter, width, fringe, color);
+        if (!first)
+            stroke_segment(stroke);
+        last = i;
+    }
+    return 1;
+}
+
+/* One draw call for the whole polyline */
+int stroke_draw(const Stroke *stroke, SDL_Renderer *renderer)
+{
+    if (stroke->indices_count == 0)
+        return 0;
+
+    return SDL_RenderGeometry(renderer, NULL,
+            stroke->vertices, stroke->vertices_count,
+            stroke->indices, stroke->indices_count);
+}
+
+/* Forgets what the mesh was built from, the next update rebuilds it */
+void stroke_invalidate(Stroke *stroke)
+{
+    stroke->built = 0;
+}
+
+void stroke_free(Stroke *stroke)
+{
+    free(stroke->vertices);
+    free(stroke->indices);
+    *stroke = (Stroke) {0};
+}
+
+/**
+ * Stroke of the index-th curve, grows the list if needed
+ * @return the stroke or NULL when out of memory
+ */
+Stroke *strokes_at(Strokes *strokes, size_t index)
+{
+    if (index >= strokes->count)
+    {
+        size_t count = strokes->count > 0 ? strokes->count : 16;
+        while (count <= index)
+            count *= 2;
+
+        Stroke *items = realloc(strokes->items, count * sizeof(Stroke));
+        if (items == NULL)
+            return NULL;
+        for (size_t i = strokes->count; i < count; i++)
+            items[i] = (Stroke) {0};
+        strokes->items = items;
+        strokes->count = count;
+    }
+    return &strokes->items[index];
+}
+
+void strokes_free(Strokes *strokes)
+{
+    for (size_t i = 0; i < strokes->count; i++)
+        stroke_free(&strokes->items[i]);
+    free(strokes->items);
+    strokes->items = NULL;
+    strokes->count = 0;
+}
+
+#endif
@@ -0,0 +1,62 @@
+/* Thick, anti-aliased polylines for SDL_RenderGeometry
+ *
+ * A polyline becomes one triangle mesh: a solid core of the given width
+ * with a fringe on both sides that fades to transparent, which gives
+ * cheap anti-aliasing without multisampling. The mesh is built in
+ * screen space and kept until the polyline or the view changes, drawing
+ * it is a single SDL_RenderGeometry call.
+ */
+
+#ifndef STROKE_H_
+#define STROKE_H_
+
+#include "SDL.h"
+
+#include "bezier.h"
+
+/* SDL_RenderGeometry appeared in SDL 2.0.18, older versions only
+ * draw 1 px lines */
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+#define STROKE_GEOMETRY
+
+/* Sharper joins are cut off at this many half widths */
+#define STROKE_MITER_LIMIT 4.0f
+
+typedef struct Stroke
+{
+    SDL_Vertex *vertices;
+    int *indices;
+    size_t capacity;
+    int vertices_count;
+    int indices_count;
+
+    /* What the mesh was built from */
+    int built;
+    unsigned version;
+    Vec2 offset;
+    float zoom;
+    float width;
+    float fringe;
+    SDL_Color color;
+} Stroke;
+
+/* Strokes of the curves of a scene, indexed like the curves */
+typedef struct Strokes
+{
+    Stroke *items;
+    size_t count;
+} Strokes;
+
+int stroke_update(Stroke *stroke, unsigned version,
+        const Vec2 *points, size_t count, Vec2 offset, float zoom,
+        float width, float fringe, SDL_Color color);
+int stroke_draw(const Stroke *stroke, SDL_Renderer *renderer);
+void stroke_invalidate(Stroke *stroke);
+void stroke_free(Stroke *stroke);
+
+Stroke *strokes_at(Strokes *strokes, size_t index);
+void strokes_free(Strokes *strokes);
+
+#endif
+
+#endif // STROKE_H_
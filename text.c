@@ -0,0 +1,707 @@
+/* Text exchange formats, see text.h */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "text.h"
+
+/* Points handed to a curve at a time */
+#define TEXT_POINTS_CHUNK 4096
+/* Significant digits a number keeps, the rest only move the exponent */
+#define TEXT_MAX_DIGITS 19
+#define TEXT_EOF (-1)
+
+typedef struct TextReader
+{
+    SDL_RWops *rw;
+    const char *file;
+    size_t line;
+    size_t pos;
+    size_t size;
+    char buffer[TEXT_CHUNK];
+} TextReader;
+
+/* Points of the curve being read, appended to it a chunk at a time */
+typedef struct TextPoints
+{
+    Scene *scene;
+    /* NULL until the first point of a curve */
+    Curve *curve;
+    size_t count;
+    Vec2 chunk[TEXT_POINTS_CHUNK];
+} TextPoints;
+
+typedef struct TextWriter
+{
+    SDL_RWops *rw;
+    int ok;
+    size_t size;
+    char buffer[TEXT_CHUNK];
+} TextWriter;
+
+/* Next char without taking it, TEXT_EOF at the end of the file */
+static int reader_peek(TextReader *reader)
+{
+    if (reader->pos == reader->size)
+    {
+        reader->size = SDL_RWread(reader->rw, reader->buffer, 1, TEXT_CHUNK);
+        reader->pos = 0;
+        if (reader->size == 0)
+            return TEXT_EOF;
+    }
+    return (unsigned char) reader->buffer[reader->pos];
+}
+
+static int reader_get(TextReader *reader)
+{
+    const int c = reader_peek(reader);
+    if (c != TEXT_EOF)
+        reader->pos++;
+    if (c == '\n')
+        reader->line++;
+    return c;
+}
+
+static int reader_error(const TextReader *reader, const char *what)
+{
+    SDL_SetError("%s:%zu: %s", reader->file, reader->line, what);
+    return 0;
+}
+
+static int is_space(int c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int is_digit(int c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/* Skips blanks but not line ends */
+static void reader_skip_blanks(TextReader *reader)
+{
+    int c = reader_peek(reader);
+    while (c == ' ' || c == '\t' || c == '\r')
+    {
+        reader->pos++;
+        c = reader_peek(reader);
+    }
+}
+
+/* Skips white space and commas, which separate SVG numbers */
+static void reader_skip_separators(TextReader *reader)
+{
+    int c = reader_peek(reader);
+    while (is_space(c) || c == ',')
+    {
+        reader_get(reader);
+        c = reader_peek(reader);
+    }
+}
+
+static void reader_skip_line(TextReader *reader)
+{
+    int c;
+    do
+        c = reader_get(reader);
+    while (c != '\n' && c != TEXT_EOF);
+}
+
+/**
+ * Takes chars up to and including the next occurrence of pattern,
+ * which must not repeat its first char
+ * @return 1 if it was found, 0 at the end of the file
+ */
+static int reader_find(TextReader *reader, const char *pattern)
+{
+    size_t matched = 0;
+    while (pattern[matched] != '\0')
+    {
+        const int c = reader_get(reader);
+        if (c == TEXT_EOF)
+            return 0;
+        if (c == (unsigned char) pattern[matched])
+            matched++;
+        else
+            matched = c == (unsigned char) pattern[0];
+    }
+    return 1;
+}
+
+/* 10^e for e in [0, 22], all exact in a double */
+static double text_pow10(int e)
+{
+    static const double table[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    return e < (int) (sizeof(table) / sizeof(table[0])) ? table[e] : pow(10.0, e);
+}
+
+/**
+ * Parses [+-]digits[.digits][(e|E)[+-]digits] straight out of the
+ * buffer, without the locale lookups and copies of strtof or sscanf.
+ * The first TEXT_MAX_DIGITS significant digits are gathered in an
+ * integer and the rest are dropped. The integer is scaled by a power of
+ * ten in double, and the power is exact up to 1e22. With at most 15
+ * digits and such an exponent, the double is correctly rounded. The
+ * cast to float rounds once more, so the result can be 1 ulp off
+ * strtof in rare ties. Longer mantissas or larger exponents add a few
+ * more double roundings, which is still far below float precision.
+ * @return 1 if a number was read, 0 if the next chars aren't one
+ */
+static int reader_float(TextReader *reader, float *value)
+{
+    int c = reader_peek(reader);
+    const int negative = c == '-';
+    if (c == '+' || c == '-')
+    {
+        reader->pos++;
+        c = reader_peek(reader);
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    int any = 0;
+    for (; is_digit(c); c = reader_peek(reader))
+    {
+        if (digits < TEXT_MAX_DIGITS)
+        {
+            mantissa = mantissa * 10 + (uint64_t) (c - '0');
+            digits += mantissa > 0;
+        }
+        else
+        {
+            exponent++;
+        }
+        any = 1;
+        reader->pos++;
+    }
+    if (c == '.')
+    {
+        reader->pos++;
+        for (c = reader_peek(reader); is_digit(c); c = reader_peek(reader))
+        {
+            if (digits < TEXT_MAX_DIGITS)
+            {
+                mantissa = mantissa * 10 + (uint64_t) (c - '0');
+                digits += mantissa > 0;
+                exponent--;
+            }
+            any = 1;
+            reader->pos++;
+        }
+    }
+    if (!any)
+        return 0;
+
+    if (c == 'e' || c == 'E')
+    {
+        reader->pos++;
+        c = reader_peek(reader);
+        const int negative_exponent = c == '-';
+        if (c == '+' || c == '-')
+        {
+            reader->pos++;
+            c = reader_peek(reader);
+        }
+        if (!is_digit(c))
+            return 0;
+
+        int e = 0;
+        for (; is_digit(c); c = reader_peek(reader))
+        {
+            if (e < 1000)
+                e = e * 10 + (c - '0');
+            reader->pos++;
+        }
+        exponent += negative_exponent ? -e : e;
+    }
+
+    double result = (double) mantissa;
+    if (exponent < 0)
+        result /= text_pow10(-exponent);
+    else if (exponent > 0)
+        result *= text_pow10(exponent);
+    *value = (float) (negative ? -result : result);
+    return 1;
+}
+
+static int points_flush(TextPoints *points)
+{
+    if (points->count == 0)
+        return 1;
+    if (!curve_append(points->curve, points->chunk, points->count))
+    {
+        SDL_OutOfMemory();
+        return 0;
+    }
+    points->count = 0;
+    return 1;
+}
+
+static int points_add(TextPoints *points, Vec2 point)
+{
+    if (points->curve == NULL)
+    {
+        points->curve = scene_empty_curve(points->scene);
+        if (points->curve == NULL)
+        {
+            SDL_OutOfMemory();
+            return 0;
+        }
+    }
+    if (points->count == TEXT_POINTS_CHUNK && !points_flush(points))
+        return 0;
+
+    points->chunk[points->count++] = point;
+    return 1;
+}
+
+/* The next point starts a new curve */
+static int points_end_curve(TextPoints *points)
+{
+    if (!points_flush(points))
+        return 0;
+    points->curve = NULL;
+    return 1;
+}
+
+/**
+ * Opens file and runs parse over it with a reader and a point sink,
+ * which are too big for the stack
+ */
+static int text_import_file(Scene *scene, const char *file,
+        int (*parse)(TextReader *reader, TextPoints *points))
+{
+    TextReader *reader = malloc(sizeof(TextReader));
+    TextPoints *points = malloc(sizeof(TextPoints));
+    if (reader == NULL || points == NULL)
+    {
+        free(reader);
+        free(points);
+        SDL_OutOfMemory();
+        return 0;
+    }
+
+    int ok = 0;
+    reader->rw = SDL_RWFromFile(file, "rb");
+    if (reader->rw != NULL)
+    {
+        reader->file = file;
+        reader->line = 1;
+        reader->pos = 0;
+        reader->size = 0;
+        points->scene = scene;
+        points->curve = NULL;
+        points->count = 0;
+
+        ok = parse(reader, points) && points_flush(points);
+        SDL_RWclose(reader->rw);
+    }
+
+    free(reader);
+    free(points);
+    return ok;
+}
+
+static int text_parse_csv(TextReader *reader, TextPoints *points)
+{
+    for (;;)
+    {
+        reader_skip_blanks(reader);
+        const int c = reader_peek(reader);
+        if (c == TEXT_EOF)
+            return 1;
+
+        if (c == '\n')
+        {
+            reader_get(reader);
+            if (points->curve != NULL && !points_end_curve(points))
+                return 0;
+            continue;
+        }
+        if (c == '#')
+        {
+            reader_skip_line(reader);
+            continue;
+        }
+
+        Vec2 point;
+        if (!reader_float(reader, &point.x))
+            return reader_error(reader, "expected a number");
+        reader_skip_blanks(reader);
+        if (reader_peek(reader) == ',' || reader_peek(reader) == ';')
+            reader->pos++;
+        reader_skip_blanks(reader);
+        if (!reader_float(reader, &point.y))
+            return reader_error(reader, "expected a second number");
+        if (!points_add(points, point))
+            return 0;
+
+        /* Further columns are ignored */
+        reader_skip_line(reader);
+    }
+}
+
+/**
+ * Adds the points of a CSV point list to the scene, see text.h
+ * @return 1 on success, 0 on error, see SDL_GetError
+ */
+int text_import_csv(Scene *scene, const char *file)
+{
+    return text_import_file(scene, file, text_parse_csv);
+}
+
+/* Reads count numbers of an SVG path command */
+static int text_svg_numbers(TextReader *reader, float *numbers, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        reader_skip_separators(reader);
+        if (!reader_float(reader, numbers + i))
+            return reader_error(reader, "expected a number in the path data");
+    }
+    return 1;
+}
+
+static int text_svg_cubic(TextPoints *points, Vec2 c1, Vec2 c2, Vec2 p)
+{
+    return points_add(points, c1) && points_add(points, c2) && points_add(points, p);
+}
+
+/* A straight line as a cubic of the chain */
+static int text_svg_line(TextPoints *points, Vec2 from, Vec2 to)
+{
+    return text_svg_cubic(points,
+            lerpv2(from, to, 1.0f / 3.0f), lerpv2(from, to, 2.0f / 3.0f), to);
+}
+
+/**
+ * Parses the path data of a d attribute up to the closing quote.
+ * Commands and their implicit repetitions, absolute and relative:
+ * M L H V C S Q T Z.
+ */
+static int text_svg_path(TextReader *reader, TextPoints *points, int quote)
+{
+    Vec2 current = vec2(0.0f, 0.0f);
+    Vec2 start = current;
+    /* Last control point, mirrored by S and T */
+    Vec2 control = current;
+    int command = 0;
+    int previous = 0;
+
+    for (;;)
+    {
+        reader_skip_separators(reader);
+        int c = reader_peek(reader);
+        if (c == quote)
+        {
+            reader->pos++;
+            return points_end_curve(points);
+        }
+        if (c == TEXT_EOF)
+            return reader_error(reader, "unterminated path data");
+
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'))
+        {
+            command = c;
+            reader->pos++;
+        }
+        else if (command == 0 || command == 'Z' || command == 'z')
+        {
+            return reader_error(reader, "expected a path command");
+        }
+
+        const int relative = command >= 'a';
+        const Vec2 origin = relative ? current : vec2(0.0f, 0.0f);
+        const int type = relative ? command - 'a' + 'A' : command;
+        if (type != 'M' && points->curve == NULL && type != 'Z')
+            return reader_error(reader, "path data doesn't start with M");
+
+        float n[6];
+        Vec2 c1, c2, p;
+        switch (type)
+        {
+            case 'M':
+                if (!text_svg_numbers(reader, n, 2) || !points_end_curve(points))
+                    return 0;
+                current = start = vec2_add(origin, vec2(n[0], n[1]));
+                if (!points_add(points, current))
+                    return 0;
+                /* More pairs after M are lines */
+                command = relative ? 'l' : 'L';
+                break;
+
+            case 'L':
+            case 'H':
+            case 'V':
+                if (!text_svg_numbers(reader, n, type == 'L' ? 2 : 1))
+                    return 0;
+                p = type == 'L' ? vec2_add(origin, vec2(n[0], n[1]))
+                    : type == 'H' ? vec2(origin.x + n[0], current.y)
+                    : vec2(current.x, origin.y + n[0]);
+                if (!text_svg_line(points, current, p))
+                    return 0;
+                current = p;
+                break;
+
+            case 'C':
+            case 'S':
+                if (!text_svg_numbers(reader, n, type == 'C' ? 6 : 4))
+                    return 0;
+                if (type == 'C')
+                {
+                    c1 = vec2_add(origin, vec2(n[0], n[1]));
+                    c2 = vec2_add(origin, vec2(n[2], n[3]));
+                    p = vec2_add(origin, vec2(n[4], n[5]));
+                }
+                else
+                {
+                    c1 = previous == 'C' || previous == 'S'
+                        ? vec2_sub(vec2_scale(current, 2.0f), control)
+                        : current;
+                    c2 = vec2_add(origin, vec2(n[0], n[1]));
+                    p = vec2_add(origin, vec2(n[2], n[3]));
+                }
+                if (!text_svg_cubic(points, c1, c2, p))
+                    return 0;
+                control = c2;
+                current = p;
+                break;
+
+            case 'Q':
+            case 'T':
+                if (!text_svg_numbers(reader, n, type == 'Q' ? 4 : 2))
+                    return 0;
+                if (type == 'Q')
+                {
+                    c1 = vec2_add(origin, vec2(n[0], n[1]));
+                    p = vec2_add(origin, vec2(n[2], n[3]));
+                }
+                else
+                {
+                    c1 = previous == 'Q' || previous == 'T'
+                        ? vec2_sub(vec2_scale(current, 2.0f), control)
+                        : current;
+                    p = vec2_add(origin, vec2(n[0], n[1]));
+                }
+                /* Degree elevation, the cubic traces the same parabola */
+                if (!text_svg_cubic(points,
+                        lerpv2(current, c1, 2.0f / 3.0f),
+                        lerpv2(p, c1, 2.0f / 3.0f), p))
+                    return 0;
+                control = c1;
+                current = p;
+                break;
+
+            case 'Z':
+                if (points->curve != NULL
+                    && (current.x != start.x || current.y != start.y)
+                    && !text_svg_line(points, current, start))
+                    return 0;
+                current = start;
+                break;
+
+            default:
+                return reader_error(reader, "unsupported path command");
+        }
+        previous = type;
+    }
+}
+
+/* Reads the attributes of a tag up to its end, parsing a d attribute */
+static int text_svg_attributes(TextReader *reader, TextPoints *points)
+{
+    for (;;)
+    {
+        reader_skip_separators(reader);
+        int c = reader_peek(reader);
+        if (c == TEXT_EOF)
+            return reader_error(reader, "unterminated tag");
+        if (c == '>')
+            return 1;
+        if (c == '/')
+        {
+            reader->pos++;
+            continue;
+        }
+
+        /* Attribute name, only d matters */
+        char name[2] = {0};
+        size_t length = 0;
+        while (c != TEXT_EOF && c != '=' && c != '>' && !is_space(c))
+        {
+            if (length < sizeof(name))
+                name[length] = (char) c;
+            length++;
+            reader->pos++;
+            c = reader_peek(reader);
+        }
+
+        reader_skip_separators(reader);
+        if (reader_peek(reader) != '=')
+            continue;
+        reader->pos++;
+        reader_skip_separators(reader);
+
+        const int quote = reader_get(reader);
+        if (quote != '"' && quote != '\'')
+            return reader_error(reader, "expected a quoted attribute value");
+
+        if (length == 1 && name[0] == 'd')
+        {
+            if (!text_svg_path(reader, points, quote))
+                return 0;
+        }
+        else
+        {
+            do
+                c = reader_get(reader);
+            while (c != quote && c != TEXT_EOF);
+        }
+    }
+}
+
+static int text_parse_svg(TextReader *reader, TextPoints *points)
+{
+    while (reader_find(reader, "<path"))
+    {
+        if (!is_space(reader_peek(reader)))
+            continue;
+        if (!text_svg_attributes(reader, points))
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * Adds a curve for every subpath of the paths of an SVG file to the
+ * scene, see text.h
+ * @return 1 on success, 0 on error, see SDL_GetError
+ */
+int text_import_svg(Scene *scene, const char *file)
+{
+    return text_import_file(scene, file, text_parse_svg);
+}
+
+/* Picks the importer by the extension of file, CSV unless it's .svg */
+int text_import(Scene *scene, const char *file)
+{
+    const size_t length = strlen(file);
+    if (length >= 4 && SDL_strcasecmp(file + length - 4, ".svg") == 0)
+        return text_import_svg(scene, file);
+    return text_import_csv(scene, file);
+}
+
+static void writer_flush(TextWriter *writer)
+{
+    if (writer->ok && writer->size > 0
+        && SDL_RWwrite(writer->rw, writer->buffer, 1, writer->size) != writer->size)
+        writer->ok = 0;
+    writer->size = 0;
+}
+
+static void writer_text(TextWriter *writer, const char *text)
+{
+    for (; *text != '\0'; text++)
+    {
+        if (writer->size == TEXT_CHUNK)
+            writer_flush(writer);
+        writer->buffer[writer->size++] = *text;
+    }
+}
+
+/* Writes value with two decimals, without going through printf */
+static void writer_float(TextWriter *writer, float value)
+{
+    char text[32];
+    char *end = text + sizeof(text);
+    char *digit = end;
+    *--digit = '\0';
+
+    long long hundredths = isfinite(value) ? llroundf(fabsf(value) * 100.0f) : 0;
+    for (int i = 0; i < 2; i++)
+    {
+        *--digit = (char) ('0' + hundredths % 10);
+        hundredths /= 10;
+    }
+    *--digit = '.';
+    do
+    {
+        *--digit = (char) ('0' + hundredths % 10);
+        hundredths /= 10;
+    }
+    while (hundredths > 0 && digit > text + 1);
+    if (value < 0.0f)
+        *--digit = '-';
+
+    writer_text(writer, digit);
+}
+
+/**
+ * Writes the cached samples of every curve as an SVG polyline.
+ * Curves without points or an up to date cache are left out.
+ * @param file : const char Path of the SVG file, replaced if it exists
+ * @param width, height : float Size of the drawing
+ * @return 1 on success, 0 on error, see SDL_GetError
+ */
+int text_export_svg(const Scene *scene, const char *file, float width, float height)
+{
+    TextWriter *writer = malloc(sizeof(TextWriter));
+    if (writer == NULL)
+    {
+        SDL_OutOfMemory();
+        return 0;
+    }
+
+    writer->rw = SDL_RWFromFile(file, "wb");
+    if (writer->rw == NULL)
+    {
+        free(writer);
+        return 0;
+    }
+    writer->ok = 1;
+    writer->size = 0;
+
+    writer_text(writer, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"");
+    writer_float(writer, width);
+    writer_text(writer, "\" height=\"");
+    writer_float(writer, height);
+    writer_text(writer, "\">\n");
+
+    for (size_t i = 0; i < scene->count; i++)
+    {
+        const Curve *curve = scene->curves[i];
+        const SampleCache *cache = &curve->cache;
+        if (curve->count == 0 || cache->dirty)
+            continue;
+
+        writer_text(writer, "<polyline fill=\"none\" stroke=\"black\" points=\"");
+        for (size_t j = 0; j <= cache->count; j++)
+        {
+            if (j > 0)
+                writer_text(writer, " ");
+            writer_float(writer, cache->samples[j].x);
+            writer_text(writer, ",");
+            writer_float(writer, cache->samples[j].y);
+        }
+        writer_text(writer, "\"/>\n");
+    }
+    writer_text(writer, "</svg>\n");
+    writer_flush(writer);
+
+    int ok = writer->ok;
+    if (!ok)
+        SDL_SetError("couldn't write %s", file);
+    if (SDL_RWclose(writer->rw) < 0)
+        ok = 0;
+    free(writer);
+    return ok;
+}
@@ -0,0 +1,32 @@
+/* Text exchange formats
+ *
+ * CSV point lists and SVG path data are read in TEXT_CHUNK sized pieces,
+ * never the whole file at once, with a number parser of our own instead
+ * of sscanf. The points go straight into the curves of a scene.
+ *
+ * CSV: one "x,y" point per line, a blank line ends a curve and lines
+ * starting with # are comments.
+ *
+ * SVG: the d attribute of every <path> element. Every subpath becomes
+ * a curve stored as a chain of cubics, see bezier_chain_sample: lines
+ * and quadratics are raised to cubics, arcs aren't supported.
+ *
+ * The export writes the cached samples of every curve as an SVG
+ * polyline, through a buffered writer.
+ */
+
+#ifndef TEXT_H_
+#define TEXT_H_
+
+#include "scene.h"
+
+/* Bytes read or written at a time */
+#define TEXT_CHUNK (64 * 1024)
+
+int text_import_csv(Scene *scene, const char *file);
+int text_import_svg(Scene *scene, const char *file);
+int text_import(Scene *scene, const char *file);
+
+int text_export_svg(const Scene *scene, const char *file, float width, float height);
+
+#endif // TEXT_H_